@@ -9,38 +9,57 @@ namespace Tmpl8 {
         grid_width = (int)(width / cell_size) + 1;
         grid_height = (int)(height / cell_size) + 1;
 
-        // Initialize the grid with empty vectors
-        grid_cells.resize(grid_width);
-        for (int i = 0; i < grid_width; i++) {
-            grid_cells[i].resize(grid_height);
-        }
+        // One bucket per team per cell, plus the end offset of the last bucket
+        bucket_offsets.resize(grid_width * grid_height * 2 + 1, 0);
+        bucket_cursors.resize(grid_width * grid_height * 2);
     }
 
     Grid::~Grid()
     {
-        // Grid doesn't need to free up memory because it only contains pointers
-        // that point to tanks managed elsewhere
+        // Grid doesn't need to free up memory because it only contains indices
+        // of tanks managed elsewhere
     }
 
-    void Grid::add_tanks(std::vector<Tank>& tanks)
+    void Grid::add_tanks(const TankStore& tanks)
     {
         // Clear the grid first
         clear();
 
-        // Add each tank to the grid
-        for (auto& tank : tanks) {
-            if (tank.active) {
-                std::array<int, 2> cell_idx = get_cell_index(tank.position);
-                if (is_valid_cell(cell_idx[0], cell_idx[1])) {
-                    grid_cells[cell_idx[0]][cell_idx[1]].push_back(&tank);
-                }
+        // First pass: find the bucket of every tank and count the tanks per bucket
+        tank_buckets.resize(tanks.size());
+        for (uint32_t i = 0; i < tanks.size(); i++) {
+            tank_buckets[i] = -1;
+            if (!tanks.active[i]) continue;
+
+            std::array<int, 2> cell_idx = get_cell_index(tanks.positions[i]);
+            if (is_valid_cell(cell_idx[0], cell_idx[1])) {
+                tank_buckets[i] = get_bucket(cell_idx[0], cell_idx[1], tanks.alignments[i]);
+                bucket_offsets[tank_buckets[i] + 1]++;
+            }
+            else {
+                outside_tanks.push_back(i);
+            }
+            max_tank_radius = std::max(max_tank_radius, tanks.collision_radii[i]);
+        }
+
+        // Turn the counts into start offsets
+        for (size_t bucket = 1; bucket < bucket_offsets.size(); bucket++) {
+            bucket_offsets[bucket] += bucket_offsets[bucket - 1];
+        }
+
+        // Second pass: write every tank to the next free slot of its bucket
+        cell_tanks.resize(bucket_offsets.back());
+        std::copy(bucket_offsets.begin(), bucket_offsets.end() - 1, bucket_cursors.begin());
+        for (uint32_t i = 0; i < tanks.size(); i++) {
+            if (tank_buckets[i] >= 0) {
+                cell_tanks[bucket_cursors[tank_buckets[i]]++] = i;
             }
         }
     }
 
-    std::vector<Tank*> Grid::find_tanks_in_radius(const vec2& position, float radius, allignments alignment)
+    std::vector<uint32_t> Grid::find_tanks_in_radius(const TankStore& tanks, const vec2& position, float radius, allignments alignment)
     {
-        std::vector<Tank*> result;
+        std::vector<uint32_t> result;
 
         // Determine the cells that overlap with the radius
         float radius_squared = radius * radius;
@@ -55,12 +74,13 @@ namespace Tmpl8 {
                 int cell_y = center_cell[1] + dy;
 
                 if (is_valid_cell(cell_x, cell_y)) {
-                    // Go through all the tanks in this cell
-                    for (Tank* tank : grid_cells[cell_x][cell_y]) {
-                        // Check that the tank is within the radius and has the correct alignment
-                        vec2 diff = tank->position - position;
-                        if (diff.sqr_length() <= radius_squared &&
-                            (alignment == tank->allignment || alignment == BLUE && tank->allignment == RED || alignment == RED && tank->allignment == BLUE)) {
+                    // Go through all the tanks of the requested team in this cell
+                    int bucket = get_bucket(cell_x, cell_y, alignment);
+                    for (uint32_t i = bucket_offsets[bucket]; i < bucket_offsets[bucket + 1]; i++) {
+                        // Check that the tank is within the radius
+                        uint32_t tank = cell_tanks[i];
+                        vec2 diff = tanks.positions[tank] - position;
+                        if (diff.sqr_length() <= radius_squared) {
                             result.push_back(tank);
                         }
                     }
@@ -71,33 +91,48 @@ namespace Tmpl8 {
         return result;
     }
 
-    Tank* Grid::find_closest_enemy(const Tank& current_tank)
+    int Grid::find_closest_enemy(const TankStore& tanks, uint32_t current_tank)
     {
         float closest_distance = std::numeric_limits<float>::infinity();
-        Tank* closest_tank = nullptr;
+        int closest_tank = -1;
+
+        const vec2 current_position = tanks.positions[current_tank];
+        const allignments enemy_alignment = (tanks.alignments[current_tank] == RED) ? BLUE : RED;
+        std::array<int, 2> center_cell = get_cell_index(current_position);
 
         // Determine the search radius (start with a small value and increase if necessary)
         float search_radius = 50.0f;
         const float max_search_radius = 1500.0f; // Maximum search distance
 
         while (search_radius <= max_search_radius) {
-            // Find tanks within current radius
-            std::vector<Tank*> nearby_tanks = find_tanks_in_radius(current_tank.position, search_radius,
-                (current_tank.allignment == RED) ? BLUE : RED);
-
-            // Find the nearest tank
-            for (Tank* tank : nearby_tanks) {
-                if (tank->active && tank->allignment != current_tank.allignment) {
-                    float sqr_dist = (tank->position - current_tank.position).sqr_length();
-                    if (sqr_dist < closest_distance) {
-                        closest_distance = sqr_dist;
-                        closest_tank = tank;
+            // Scan the enemy buckets of all cells within the current radius
+            float radius_squared = search_radius * search_radius;
+            int cell_radius = (int)(search_radius / cell_size) + 1;
+
+            for (int dx = -cell_radius; dx <= cell_radius; dx++) {
+                for (int dy = -cell_radius; dy <= cell_radius; dy++) {
+                    int cell_x = center_cell[0] + dx;
+                    int cell_y = center_cell[1] + dy;
+
+                    if (!is_valid_cell(cell_x, cell_y)) continue;
+
+                    // Find the nearest tank
+                    int bucket = get_bucket(cell_x, cell_y, enemy_alignment);
+                    for (uint32_t i = bucket_offsets[bucket]; i < bucket_offsets[bucket + 1]; i++) {
+                        uint32_t tank = cell_tanks[i];
+                        if (!tanks.active[tank]) continue;
+
+                        float sqr_dist = (tanks.positions[tank] - current_position).sqr_length();
+                        if (sqr_dist <= radius_squared && sqr_dist < closest_distance) {
+                            closest_distance = sqr_dist;
+                            closest_tank = (int)tank;
+                        }
                     }
                 }
             }
 
             // If we find a tank, stop looking
-            if (closest_tank != nullptr) {
+            if (closest_tank != -1) {
                 break;
             }
 
@@ -105,64 +140,155 @@ namespace Tmpl8 {
             search_radius *= 2.0f;
         }
 
-        // If no enemy found, take the first active enemy (fallback)
-        if (closest_tank == nullptr) {
-            // This really shouldn't happen if there are still active enemies
-            // But as a safety fallback it's good
-            return nullptr; // The game class should handle this
-        }
-
+        // If no enemy found the game class falls back to a full search
+        // This really shouldn't happen if there are still active enemies
         return closest_tank;
     }
 
-    void Grid::calculate_tank_collisions(std::vector<Tank>& tanks)
+    void Grid::calculate_tank_collisions(TankStore& tanks)
     {
-        // Add all tanks to the grid
-        add_tanks(tanks);
-
         // Loop through all active tanks
-        for (Tank& tank : tanks) {
-            if (!tank.active) continue;
+        for (uint32_t tank = 0; tank < tanks.size(); tank++) {
+            if (!tanks.active[tank]) continue;
+
+            const vec2 position = tanks.positions[tank];
+            const float collision_radius = tanks.collision_radii[tank];
 
             // Determine the current cell of the tank
-            std::array<int, 2> cell_idx = get_cell_index(tank.position);
+            std::array<int, 2> cell_idx = get_cell_index(position);
 
             // Check collision with tanks in the same and adjacent cells
+            // The three cells of a column are one contiguous range of buckets (both teams)
+            const int y_begin = std::max(cell_idx[1] - 1, 0);
+            const int y_end = std::min(cell_idx[1] + 1, grid_height - 1);
+            if (y_begin > y_end) continue;
+
             for (int dx = -1; dx <= 1; dx++) {
-                for (int dy = -1; dy <= 1; dy++) {
-                    int neighbor_x = cell_idx[0] + dx;
-                    int neighbor_y = cell_idx[1] + dy;
+                int neighbor_x = cell_idx[0] + dx;
+                if (neighbor_x < 0 || neighbor_x >= grid_width) continue;
 
-                    if (!is_valid_cell(neighbor_x, neighbor_y)) continue;
+                const uint32_t range_begin = bucket_offsets[get_bucket(neighbor_x, y_begin, BLUE)];
+                const uint32_t range_end = bucket_offsets[get_bucket(neighbor_x, y_end, RED) + 1];
 
-                    // Check all tanks in this cell
-                    for (Tank* other_tank : grid_cells[neighbor_x][neighbor_y]) {
-                        // Skip itself and inactive tanks
-                        if (&tank == other_tank || !other_tank->active) continue;
+                // Check all tanks in these cells
+                for (uint32_t i = range_begin; i < range_end; i++) {
+                    uint32_t other_tank = cell_tanks[i];
 
-                        // Calculate collision
-                        vec2 dir = tank.position - other_tank->position;
-                        float dir_squared_len = dir.sqr_length();
+                    // Skip itself and inactive tanks
+                    if (tank == other_tank || !tanks.active[other_tank]) continue;
 
-                        float col_squared_len = (tank.collision_radius + other_tank->collision_radius);
-                        col_squared_len *= col_squared_len;
+                    // Calculate collision
+                    vec2 dir = position - tanks.positions[other_tank];
+                    float dir_squared_len = dir.sqr_length();
 
-                        if (dir_squared_len < col_squared_len) {
-                            tank.push(dir.normalized(), 1.f);
-                        }
+                    float col_squared_len = (collision_radius + tanks.collision_radii[other_tank]);
+                    col_squared_len *= col_squared_len;
+
+                    if (dir_squared_len < col_squared_len) {
+                        tanks.forces[tank] += dir.normalized();
                     }
                 }
             }
         }
     }
 
-    void Grid::clear()
+    int Grid::find_rocket_collision(const TankStore& tanks, const vec2& position, float radius, allignments rocket_alignment) const
     {
-        for (int i = 0; i < grid_width; i++) {
-            for (int j = 0; j < grid_height; j++) {
-                grid_cells[i][j].clear();
+        // The lowest index hit is returned, which is the tank a brute force loop over all tanks would find first
+        int hit_tank = -1;
+
+        auto test_tank = [&](uint32_t tank) {
+            if ((hit_tank != -1 && (int)tank >= hit_tank) || !tanks.active[tank]) return;
+
+            float hit_radius = radius + tanks.collision_radii[tank];
+            if ((tanks.positions[tank] - position).sqr_length() <= hit_radius * hit_radius) {
+                hit_tank = (int)tank;
             }
+        };
+
+        // Every tank that can touch the rocket lies within this distance of its center
+        // Cell indices truncate just like get_cell_index, so the corner cells bound all candidates
+        const float query_radius = radius + max_tank_radius;
+        std::array<int, 2> min_cell = get_cell_index(position - vec2(query_radius));
+        std::array<int, 2> max_cell = get_cell_index(position + vec2(query_radius));
+
+        const int x_begin = std::max(min_cell[0], 0), x_end = std::min(max_cell[0], grid_width - 1);
+        const int y_begin = std::max(min_cell[1], 0), y_end = std::min(max_cell[1], grid_height - 1);
+
+        // Only the enemy team can be hit
+        const allignments enemy_alignment = (rocket_alignment == RED) ? BLUE : RED;
+
+        for (int x = x_begin; x <= x_end; x++) {
+            for (int y = y_begin; y <= y_end; y++) {
+                int bucket = get_bucket(x, y, enemy_alignment);
+                for (uint32_t i = bucket_offsets[bucket]; i < bucket_offsets[bucket + 1]; i++) {
+                    test_tank(cell_tanks[i]);
+                }
+            }
+        }
+
+        for (uint32_t tank : outside_tanks) {
+            if (tanks.alignments[tank] != rocket_alignment) test_tank(tank);
         }
+
+        return hit_tank;
+    }
+
+    // Horizontal extent of a convex polygon at height y, false if the line doesn't cross it
+    static bool polygon_span(const std::vector<vec2>& polygon, float y, float& left, float& right)
+    {
+        left = std::numeric_limits<float>::infinity();
+        right = -std::numeric_limits<float>::infinity();
+
+        for (size_t i = 0; i < polygon.size(); i++) {
+            const vec2& a = polygon[i];
+            const vec2& b = polygon[(i + 1) % polygon.size()];
+            if (a.y == b.y || y < std::min(a.y, b.y) || y > std::max(a.y, b.y)) continue;
+
+            float x = a.x + (y - a.y) * (b.x - a.x) / (b.y - a.y);
+            left = std::min(left, x);
+            right = std::max(right, x);
+        }
+
+        return left < right;
+    }
+
+    void Grid::find_tanks_outside_polygon(const TankStore& tanks, const std::vector<vec2>& convex_polygon, int row_begin, int row_end, std::vector<uint32_t>& result) const
+    {
+        for (int y = std::max(row_begin, 0); y < std::min(row_end, grid_height); y++) {
+            // A cell lies inside a convex polygon if its corners do, so the cells of this row that are strictly
+            // inside the span of the polygon at both the top and the bottom of the row can be skipped
+            // get_cell_index truncates, so the first row and column also hold tanks slightly below 0 and are never
+            // skipped. The last row and column are kept as well, so no cell at the border of the grid is skipped
+            int inside_begin = 0, inside_end = 0;
+            float top_left, top_right, bottom_left, bottom_right;
+            if (y > 0 && y < grid_height - 1 &&
+                polygon_span(convex_polygon, y * cell_size, top_left, top_right) &&
+                polygon_span(convex_polygon, (y + 1) * cell_size, bottom_left, bottom_right)) {
+                inside_begin = std::max((int)std::floor(std::max(top_left, bottom_left) / cell_size) + 1, 1);
+                inside_end = std::min((int)std::ceil(std::min(top_right, bottom_right) / cell_size) - 1, grid_width - 1);
+            }
+
+            for (int x = 0; x < grid_width; x++) {
+                if (x >= inside_begin && x < inside_end) {
+                    x = inside_end - 1;
+                    continue;
+                }
+
+                // Both teams of a cell are adjacent buckets
+                for (uint32_t i = bucket_offsets[get_bucket(x, y, BLUE)]; i < bucket_offsets[get_bucket(x, y, RED) + 1]; i++) {
+                    if (tanks.active[cell_tanks[i]]) result.push_back(cell_tanks[i]);
+                }
+            }
+        }
+    }
+
+    void Grid::clear()
+    {
+        std::fill(bucket_offsets.begin(), bucket_offsets.end(), 0);
+        cell_tanks.clear();
+        outside_tanks.clear();
+        max_tank_radius = 0.f;
     }
 
     std::array<int, 2> Grid::get_cell_index(const vec2& position) const
@@ -177,4 +303,4 @@ namespace Tmpl8 {
         return (x >= 0 && x < grid_width && y >= 0 && y < grid_height);
     }
 
-} // namespace Tmpl8
\ No newline at end of file
+} // namespace Tmpl8
@@ -2,9 +2,6 @@
 
 namespace Tmpl8 {
 
-    // Forward declaration
-    class Tank;
-
     // Grid class for spatial partitioning of the game objects
     // This speeds up collision detection and finding nearby objects considerably
     class Grid
@@ -14,17 +11,30 @@ namespace Tmpl8 {
         Grid(int screen_width, int screen_height, float cell_size);
         ~Grid();
 
-        // Add all tanks to the grid
-        void add_tanks(std::vector<Tank>& tanks);
+        // Rebuild the grid from all active tanks
+        void add_tanks(const TankStore& tanks);
 
-        // Find tanks within a certain radius around a position
-        std::vector<Tank*> find_tanks_in_radius(const vec2& position, float radius, allignments alignment = BLUE);
+        // Find the indices of tanks within a certain radius around a position
+        std::vector<uint32_t> find_tanks_in_radius(const TankStore& tanks, const vec2& position, float radius, allignments alignment = BLUE);
 
-        // Find the nearest tank of a given alignment
-        Tank* find_closest_enemy(const Tank& current_tank);
+        // Find the index of the nearest enemy of the given tank (-1 if there is none)
+        int find_closest_enemy(const TankStore& tanks, uint32_t current_tank);
 
         // Calculate collision forces between tanks in the grid
-        void calculate_tank_collisions(std::vector<Tank>& tanks);
+        void calculate_tank_collisions(TankStore& tanks);
+
+        // Find the lowest index active enemy tank that collides with the given rocket (-1 if there is none)
+        // Only the cells overlapping the rocket circle are visited, so the cost scales with local density
+        int find_rocket_collision(const TankStore& tanks, const vec2& position, float radius, allignments rocket_alignment) const;
+
+        // Append the active tanks of the rows [row_begin, row_end) that are not in a cell entirely inside the convex polygon
+        // Tanks strictly inside the polygon may still be returned, only whole cells are skipped
+        void find_tanks_outside_polygon(const TankStore& tanks, const std::vector<vec2>& convex_polygon, int row_begin, int row_end, std::vector<uint32_t>& result) const;
+
+        int get_num_rows() const { return grid_height; }
+
+        // Active tanks that are outside the grid, the grid queries don't return these
+        const std::vector<uint32_t>& get_outside_tanks() const { return outside_tanks; }
 
         // Clear the grid
         void clear();
@@ -36,8 +46,25 @@ namespace Tmpl8 {
         // Check if a cell index is within the boundaries of the grid
         bool is_valid_cell(int x, int y) const;
 
-        // Data structure for the grid: a 2D vector of vectors with pointers to tanks
-        std::vector<std::vector<std::vector<Tank*>>> grid_cells;
+        // Every cell holds two buckets, one per team, at key (cell * 2 + team)
+        // Cells are stored column by column, so the cells (x, y - 1) to (x, y + 1) form one contiguous range
+        int get_bucket(int x, int y, allignments alignment = BLUE) const { return (x * grid_height + y) * 2 + alignment; }
+
+        // Data structure for the grid, rebuilt with a counting sort:
+        // the tanks of bucket b are cell_tanks[bucket_offsets[b]] up to cell_tanks[bucket_offsets[b + 1]]
+        // Within a bucket the tanks keep their order in the tank store
+        std::vector<uint32_t> bucket_offsets;
+        std::vector<uint32_t> cell_tanks;
+
+        // Scratch buffers for the rebuild: the bucket of every tank and the write position per bucket
+        std::vector<int> tank_buckets;
+        std::vector<uint32_t> bucket_cursors;
+
+        // Active tanks that were pushed outside the grid, rockets still have to test these
+        std::vector<uint32_t> outside_tanks;
+
+        // Largest collision radius of the tanks in the grid, used to size the rocket query
+        float max_tank_radius = 0.f;
 
         // Dimensions of the grid
         int width, height;
@@ -45,4 +72,4 @@ namespace Tmpl8 {
         int grid_width, grid_height;
     };
 
-} // namespace Tmpl8
\ No newline at end of file
+} // namespace Tmpl8
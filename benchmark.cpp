@@ -0,0 +1,60 @@
+// Headless benchmark for scaling measurements
+// Built as a separate executable from the same sources with TMPL8_BENCHMARK defined (see CMakeLists.txt),
+// which leaves out the main function of template.cpp
+
+#include "precomp.h"
+
+#ifdef TMPL8_BENCHMARK
+
+int main(int argc, char** argv)
+{
+    // command line: [--tanks N] tanks per army, or [--blue N] [--red N] per army (default 2048)
+    //               [--frames N] frames to simulate (N <= 0: max_frames)
+    //               [--threads N] worker threads, 0 runs everything on the calling thread (default: one per core)
+    //               [--map FILE] terrain layout to use instead of assets/terrain.txt
+    //               [--report FILE] writes frame time percentiles and per-phase costs, .json or appended .csv
+    GameSettings settings;
+    int frames = 0;
+    const char* report_file = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "--tanks") == 0) && (i + 1 < argc)) settings.num_tanks_blue = settings.num_tanks_red = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "--blue") == 0) && (i + 1 < argc)) settings.num_tanks_blue = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "--red") == 0) && (i + 1 < argc)) settings.num_tanks_red = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "--frames") == 0) && (i + 1 < argc)) frames = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "--threads") == 0) && (i + 1 < argc)) settings.num_threads = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "--map") == 0) && (i + 1 < argc)) settings.terrain_file = argv[++i];
+        else if ((strcmp(argv[i], "--report") == 0) && (i + 1 < argc)) report_file = argv[++i];
+        else
+        {
+            printf("unknown argument: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (settings.num_tanks_blue < 1 || settings.num_tanks_red < 1)
+    {
+        printf("every army needs at least one tank\n");
+        return 1;
+    }
+
+    printf("benchmark: %i blue and %i red tanks\n", settings.num_tanks_blue, settings.num_tanks_red);
+
+    Game* game = new Game();
+    game->set_settings(settings);
+    game->init();
+    if (!game->terrain_loaded())
+    {
+        //A report of the wrong map is worse than none
+        printf("could not load map: %s\n", settings.terrain_file);
+        game->shutdown();
+        return 1;
+    }
+    game->run_headless(frames);
+
+    bool reported = !report_file || game->write_benchmark_report(report_file);
+    game->shutdown();
+    return reported ? 0 : 1;
+}
+
+#endif // TMPL8_BENCHMARK
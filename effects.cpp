@@ -0,0 +1,90 @@
+#include "precomp.h" // include (only) this in every .cpp file
+
+namespace Tmpl8
+{
+
+EffectBuffer::EffectBuffer(uint32_t lifetime, uint32_t ticks_per_frame, size_t max_effects)
+    : lifetime(lifetime), ticks_per_frame(ticks_per_frame), max_effects(max_effects)
+{
+    //With a cap the ring never grows, so allocate it completely
+    positions.resize((max_effects > 0) ? max_effects : 64);
+    spawn_times.resize(positions.size());
+}
+
+void EffectBuffer::spawn(vec2 position)
+{
+    if (count == positions.size())
+    {
+        if (max_effects > 0)
+        {
+            //Full, evict the oldest effect
+            head = (head + 1) % positions.size();
+            count--;
+        }
+        else
+        {
+            grow();
+        }
+    }
+
+    size_t slot = (head + count) % positions.size();
+    positions[slot] = position;
+    spawn_times[slot] = clock;
+    count++;
+}
+
+void EffectBuffer::tick()
+{
+    clock++;
+
+    //Oldest effects are at the head
+    if (lifetime == 0) return;
+    while (count > 0 && clock - spawn_times[head] >= lifetime)
+    {
+        head = (head + 1) % positions.size();
+        count--;
+    }
+}
+
+void EffectBuffer::add_to_hash(StateHash& hash) const
+{
+    hash.add(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t slot = (head + i) % positions.size();
+        hash.add(positions[slot]);
+        hash.add(clock - spawn_times[slot]);
+    }
+}
+
+void EffectBuffer::draw(TileRenderer& renderer, Sprite& sprite) const
+{
+    //Oldest first, newer effects are drawn on top
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t slot = (head + i) % positions.size();
+
+        uint32_t age = clock - spawn_times[slot];
+        renderer.draw_sprite(&sprite, (age / ticks_per_frame) % sprite.frames(), (int)positions[slot].x + HEALTHBAR_OFFSET, (int)positions[slot].y);
+    }
+}
+
+//Double the ring, moving the effects to the front in age order
+void EffectBuffer::grow()
+{
+    std::vector<vec2> grown_positions(positions.size() * 2);
+    std::vector<uint32_t> grown_spawn_times(positions.size() * 2);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t slot = (head + i) % positions.size();
+        grown_positions[i] = positions[slot];
+        grown_spawn_times[i] = spawn_times[slot];
+    }
+
+    positions.swap(grown_positions);
+    spawn_times.swap(grown_spawn_times);
+    head = 0;
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,47 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+//Short lived sprite animations (smoke plumes, explosions) of one type
+//All effects of a buffer share the same lifetime, so they expire in the order they were spawned:
+//the effects live in a ring buffer, oldest first, and expiring is just moving the head forward.
+//Effects only store their position and spawn time, the animation frame follows from their age,
+//so a tick doesn't have to touch the effects at all.
+class EffectBuffer
+{
+  public:
+    //lifetime: ticks an effect stays alive (0 is forever), ticks_per_frame: ticks per sprite frame (the animation loops)
+    //max_effects: cap on the number of live effects, spawning beyond it evicts the oldest (0 is no cap)
+    EffectBuffer(uint32_t lifetime, uint32_t ticks_per_frame, size_t max_effects = 0);
+
+    //Not thread safe, spawn from one thread at a time
+    void spawn(vec2 position);
+
+    //Age all effects by one tick and drop the expired ones
+    void tick();
+
+    void draw(TileRenderer& renderer, Sprite& sprite) const;
+
+    size_t size() const { return count; }
+
+    //Add the live effects (position and age, oldest first) to a state hash
+    void add_to_hash(StateHash& hash) const;
+
+  private:
+    void grow();
+
+    const uint32_t lifetime;
+    const uint32_t ticks_per_frame;
+    const size_t max_effects;
+
+    uint32_t clock = 0;
+
+    //Ring buffer, effect i (0 is the oldest) lives at slot (head + i) % capacity
+    std::vector<vec2> positions;
+    std::vector<uint32_t> spawn_times;
+    size_t head = 0;
+    size_t count = 0;
+};
+
+} // namespace Tmpl8
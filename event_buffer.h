@@ -0,0 +1,39 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+//Append only buffers for events that parallel tasks want to apply to shared state
+//Every task records its events in its own buffer, so no lock or atomic is needed while recording.
+//Once all tasks are finished the events are applied on one thread, in task order and per task in
+//recording order. That order only depends on how the work was split up, not on which thread ran which task.
+//The buffers are only cleared between phases, so they keep their memory from frame to frame.
+template <class Event>
+class EventBuffer
+{
+  public:
+    //Prepare one empty buffer per task
+    void begin(size_t num_tasks)
+    {
+        if (buffers.size() < num_tasks) buffers.resize(num_tasks);
+        for (std::vector<Event>& buffer : buffers) buffer.clear();
+    }
+
+    //Record an event from a task, every task only touches its own buffer
+    void push(size_t task, const Event& event) { buffers[task].push_back(event); }
+
+    //Call apply(event) for all recorded events, must not run concurrently with push
+    template <class F>
+    void apply(F apply)
+    {
+        for (const std::vector<Event>& buffer : buffers)
+        {
+            for (const Event& event : buffer) apply(event);
+        }
+    }
+
+  private:
+    std::vector<std::vector<Event>> buffers;
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,319 @@
+#include "precomp.h"
+
+namespace Tmpl8 {
+
+    // Positive if o -> a -> b turns counter clockwise, zero if the points are collinear
+    static float cross(const vec2& o, const vec2& a, const vec2& b)
+    {
+        return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+    }
+
+    void ForcefieldHull::update(const TankStore& tanks, const Grid& grid, ThreadPool& thread_pool)
+    {
+        // Last frame's hull tanks that are still alive lie inside (or on) this frame's hull
+        inner_hull_tanks.clear();
+        for (uint32_t tank : hull_tanks)
+        {
+            if (tanks.active[tank]) inner_hull_tanks.push_back(tank);
+        }
+        build_chain(tanks, inner_hull_tanks, thread_pool);
+        inner_hull_tanks.swap(chain);
+
+        inner_hull.clear();
+        for (uint32_t tank : inner_hull_tanks) inner_hull.push_back(tanks.positions[tank]);
+
+        collect_candidates(tanks, grid, thread_pool);
+
+        if (incremental && is_unchanged(tanks)) return;
+
+        build_chain(tanks, candidates, thread_pool);
+
+        hull.clear();
+        hull_tanks.swap(chain);
+        for (uint32_t tank : hull_tanks) hull.push_back(tanks.positions[tank]);
+
+        edges.clear();
+        bounds_min = vec2(std::numeric_limits<float>::infinity());
+        bounds_max = vec2(-std::numeric_limits<float>::infinity());
+        for (size_t i = 0; i < hull.size(); i++)
+        {
+            const vec2 start = hull[i];
+            const vec2 direction = hull[(i + 1) % hull.size()] - start;
+            edges.push_back(Edge{ start.x, start.y, direction.x, direction.y, direction.dot(direction) });
+
+            bounds_min = vec2(std::min(bounds_min.x, start.x), std::min(bounds_min.y, start.y));
+            bounds_max = vec2(std::max(bounds_max.x, start.x), std::max(bounds_max.y, start.y));
+        }
+    }
+
+    // The circle crosses the segment where a t^2 + b t + c = 0 has a root t in [0, 1] (see circle_segment_intersect)
+    // With f(t) = a t^2 + b t + c that is the case if:
+    // - f(0) and f(1) have opposite signs (or one is zero): exactly one segment end lies inside the circle
+    // - f(0) and f(1) are both positive, the discriminant isn't negative and the vertex -b / 2a lies in [0, 1]
+    // If both ends lie inside the circle the segment doesn't cross its outline, just like circle_segment_intersect
+    static bool circle_crosses_edge(float a, float b, float c)
+    {
+        const float f1 = a + b + c;
+        const float discriminant = b * b - 4 * a * c;
+
+        if (discriminant < 0) return false;
+        if ((c >= 0 && f1 <= 0) || (c <= 0 && f1 >= 0)) return true;
+        return c > 0 && f1 > 0 && -b >= 0 && -b <= 2 * a;
+    }
+
+    uint32_t ForcefieldHull::test_rockets(const Edge& edge, const float* xs, const float* ys, const float* radii, size_t count)
+    {
+        uint32_t hits = 0;
+        size_t i = 0;
+
+#if defined(__AVX2__)
+        const __m256 start_x8 = _mm256_set1_ps(edge.start_x), start_y8 = _mm256_set1_ps(edge.start_y);
+        const __m256 direction_x8 = _mm256_set1_ps(edge.direction_x), direction_y8 = _mm256_set1_ps(edge.direction_y);
+        const __m256 a8 = _mm256_set1_ps(edge.length_squared), two_a8 = _mm256_set1_ps(2 * edge.length_squared);
+        const __m256 four_a8 = _mm256_set1_ps(4 * edge.length_squared), two8 = _mm256_set1_ps(2), zero8 = _mm256_setzero_ps();
+
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256 fx = _mm256_sub_ps(start_x8, _mm256_loadu_ps(xs + i));
+            const __m256 fy = _mm256_sub_ps(start_y8, _mm256_loadu_ps(ys + i));
+            const __m256 r = _mm256_loadu_ps(radii + i);
+
+            const __m256 b = _mm256_mul_ps(two8, _mm256_add_ps(_mm256_mul_ps(fx, direction_x8), _mm256_mul_ps(fy, direction_y8)));
+            const __m256 c = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(fx, fx), _mm256_mul_ps(fy, fy)), _mm256_mul_ps(r, r));
+            const __m256 f1 = _mm256_add_ps(_mm256_add_ps(a8, b), c);
+            const __m256 discriminant = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(four_a8, c));
+            const __m256 minus_b = _mm256_sub_ps(zero8, b);
+
+            const __m256 ends_differ = _mm256_or_ps(
+                _mm256_and_ps(_mm256_cmp_ps(c, zero8, _CMP_GE_OQ), _mm256_cmp_ps(f1, zero8, _CMP_LE_OQ)),
+                _mm256_and_ps(_mm256_cmp_ps(c, zero8, _CMP_LE_OQ), _mm256_cmp_ps(f1, zero8, _CMP_GE_OQ)));
+            const __m256 vertex_inside = _mm256_and_ps(
+                _mm256_and_ps(_mm256_cmp_ps(c, zero8, _CMP_GT_OQ), _mm256_cmp_ps(f1, zero8, _CMP_GT_OQ)),
+                _mm256_and_ps(_mm256_cmp_ps(minus_b, zero8, _CMP_GE_OQ), _mm256_cmp_ps(minus_b, two_a8, _CMP_LE_OQ)));
+            const __m256 hit = _mm256_and_ps(_mm256_cmp_ps(discriminant, zero8, _CMP_GE_OQ), _mm256_or_ps(ends_differ, vertex_inside));
+
+            hits |= (uint32_t)_mm256_movemask_ps(hit) << i;
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        const __m128 start_x4 = _mm_set1_ps(edge.start_x), start_y4 = _mm_set1_ps(edge.start_y);
+        const __m128 direction_x4 = _mm_set1_ps(edge.direction_x), direction_y4 = _mm_set1_ps(edge.direction_y);
+        const __m128 a4 = _mm_set1_ps(edge.length_squared), two_a4 = _mm_set1_ps(2 * edge.length_squared);
+        const __m128 four_a4 = _mm_set1_ps(4 * edge.length_squared), two4 = _mm_set1_ps(2), zero4 = _mm_setzero_ps();
+
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128 fx = _mm_sub_ps(start_x4, _mm_loadu_ps(xs + i));
+            const __m128 fy = _mm_sub_ps(start_y4, _mm_loadu_ps(ys + i));
+            const __m128 r = _mm_loadu_ps(radii + i);
+
+            const __m128 b = _mm_mul_ps(two4, _mm_add_ps(_mm_mul_ps(fx, direction_x4), _mm_mul_ps(fy, direction_y4)));
+            const __m128 c = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(fx, fx), _mm_mul_ps(fy, fy)), _mm_mul_ps(r, r));
+            const __m128 f1 = _mm_add_ps(_mm_add_ps(a4, b), c);
+            const __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(four_a4, c));
+            const __m128 minus_b = _mm_sub_ps(zero4, b);
+
+            const __m128 ends_differ = _mm_or_ps(
+                _mm_and_ps(_mm_cmpge_ps(c, zero4), _mm_cmple_ps(f1, zero4)),
+                _mm_and_ps(_mm_cmple_ps(c, zero4), _mm_cmpge_ps(f1, zero4)));
+            const __m128 vertex_inside = _mm_and_ps(
+                _mm_and_ps(_mm_cmpgt_ps(c, zero4), _mm_cmpgt_ps(f1, zero4)),
+                _mm_and_ps(_mm_cmpge_ps(minus_b, zero4), _mm_cmple_ps(minus_b, two_a4)));
+            const __m128 hit = _mm_and_ps(_mm_cmpge_ps(discriminant, zero4), _mm_or_ps(ends_differ, vertex_inside));
+
+            hits |= (uint32_t)_mm_movemask_ps(hit) << i;
+        }
+#endif
+
+        // Remaining rockets one by one
+        for (; i < count; i++)
+        {
+            const float fx = edge.start_x - xs[i];
+            const float fy = edge.start_y - ys[i];
+            const float b = 2 * (fx * edge.direction_x + fy * edge.direction_y);
+            const float c = (fx * fx + fy * fy) - radii[i] * radii[i];
+
+            if (circle_crosses_edge(edge.length_squared, b, c)) hits |= 1u << i;
+        }
+
+        return hits;
+    }
+
+    void ForcefieldHull::find_rocket_collisions(const RocketPool& rockets, ThreadPool& thread_pool, std::vector<uint32_t>& hit_rockets)
+    {
+        hit_rockets.clear();
+        if (edges.empty()) return;
+
+        // Every task tests a range of rockets, the hits are concatenated in task order
+        const size_t num_tasks = (rockets.size() + rockets_per_task - 1) / rockets_per_task;
+        task_hits.resize(num_tasks);
+
+        thread_pool.parallel_for(0, rockets.size(), rockets_per_task, [&](size_t begin, size_t end) {
+            std::vector<uint32_t>& hits = task_hits[begin / rockets_per_task];
+            hits.clear();
+
+            // Batches of 32 rockets, so the lanes of a batch fit in one mask
+            constexpr size_t batch_size = 32;
+            alignas(32) float xs[batch_size], ys[batch_size], radii[batch_size];
+            uint32_t ids[batch_size];
+
+            size_t rocket = begin;
+            while (rocket < end)
+            {
+                // Gather the active rockets that touch the bounding box of the hull
+                size_t count = 0;
+                for (; rocket < end && count < batch_size; rocket++)
+                {
+                    const Rocket& r = rockets[rocket];
+                    if (!r.active) continue;
+
+                    const vec2& p = r.position;
+                    const float radius = r.collision_radius;
+                    if (p.x + radius < bounds_min.x || p.x - radius > bounds_max.x || p.y + radius < bounds_min.y || p.y - radius > bounds_max.y) continue;
+
+                    xs[count] = p.x;
+                    ys[count] = p.y;
+                    radii[count] = radius;
+                    ids[count] = (uint32_t)rocket;
+                    count++;
+                }
+                if (count == 0) continue;
+
+                // Test the batch against every edge, until all rockets of the batch hit something
+                const uint32_t all_lanes = (count == 32) ? 0xFFFFFFFFu : ((1u << count) - 1);
+                uint32_t batch_hits = 0;
+                for (const Edge& edge : edges)
+                {
+                    batch_hits |= test_rockets(edge, xs, ys, radii, count);
+                    if (batch_hits == all_lanes) break;
+                }
+
+                for (size_t lane = 0; lane < count; lane++)
+                {
+                    if (batch_hits & (1u << lane)) hits.push_back(ids[lane]);
+                }
+            }
+        });
+
+        for (const std::vector<uint32_t>& hits : task_hits)
+        {
+            hit_rockets.insert(hit_rockets.end(), hits.begin(), hits.end());
+        }
+    }
+
+    void ForcefieldHull::collect_candidates(const TankStore& tanks, const Grid& grid, ThreadPool& thread_pool)
+    {
+        candidates.clear();
+
+        if (inner_hull.size() < 3)
+        {
+            // Without an inner polygon (first frame, or only a few tanks left) every active tank is a candidate
+            for (uint32_t tank = 0; tank < tanks.size(); tank++)
+            {
+                if (tanks.active[tank]) candidates.push_back(tank);
+            }
+            return;
+        }
+
+        // Every task collects the candidates of a few grid rows, they are concatenated in row order
+        const int num_rows = grid.get_num_rows();
+        const size_t num_tasks = (num_rows + rows_per_task - 1) / rows_per_task;
+        task_candidates.resize(num_tasks);
+
+        thread_pool.parallel_for(0, num_tasks, 1, [&](size_t begin, size_t end) {
+            for (size_t task = begin; task < end; task++)
+            {
+                task_candidates[task].clear();
+                grid.find_tanks_outside_polygon(tanks, inner_hull, (int)task * rows_per_task, ((int)task + 1) * rows_per_task, task_candidates[task]);
+            }
+        });
+
+        for (const std::vector<uint32_t>& task : task_candidates)
+        {
+            candidates.insert(candidates.end(), task.begin(), task.end());
+        }
+
+        // Tanks pushed off the grid aren't in any cell
+        for (uint32_t tank : grid.get_outside_tanks())
+        {
+            if (tanks.active[tank]) candidates.push_back(tank);
+        }
+
+        // The inner hull tanks themselves can sit on a horizontal edge of the polygon that the grid query skips
+        candidates.insert(candidates.end(), inner_hull_tanks.begin(), inner_hull_tanks.end());
+    }
+
+    bool ForcefieldHull::is_unchanged(const TankStore& tanks) const
+    {
+        // The inner hull equals the old hull if none of its vertex tanks moved or died
+        if (inner_hull.size() < 3 || inner_hull != hull) return false;
+
+        // Then the hull only changes if another tank moved outside of it
+        for (uint32_t tank : candidates)
+        {
+            for (size_t i = 0; i < hull.size(); i++)
+            {
+                if (cross(hull[i], hull[(i + 1) % hull.size()], tanks.positions[tank]) < 0) return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Andrew's monotone chain: sort the points on x (then y) and build the lower and upper hull in one sweep each
+    void ForcefieldHull::build_chain(const TankStore& tanks, std::vector<uint32_t>& points, ThreadPool& thread_pool)
+    {
+        const std::vector<vec2>& positions = tanks.positions;
+
+        // Both sorts give the same order, the radix sort only pays off when there are many points
+        if (points.size() < radix_sort_min_points)
+        {
+            std::sort(points.begin(), points.end(), [&](uint32_t a, uint32_t b) {
+                if (positions[a].x != positions[b].x) return positions[a].x < positions[b].x;
+                if (positions[a].y != positions[b].y) return positions[a].y < positions[b].y;
+                return a < b;
+            });
+        }
+        else
+        {
+            // Stable radix passes from the least to the most significant key: tank index, y, x
+            // The tank index makes the order independent of the candidate order and puts duplicates next to each other
+            sort_keys.assign(points.begin(), points.end());
+            radix_sort.sort(sort_keys, points, thread_pool, RadixSort::key_bits_for((uint32_t)tanks.size()));
+
+            // Adding 0 turns -0 into +0, the comparison order treats them as equal
+            for (size_t i = 0; i < points.size(); i++) sort_keys[i] = RadixSort::float_key(positions[points[i]].y + 0.f);
+            radix_sort.sort(sort_keys, points, thread_pool);
+
+            for (size_t i = 0; i < points.size(); i++) sort_keys[i] = RadixSort::float_key(positions[points[i]].x + 0.f);
+            radix_sort.sort(sort_keys, points, thread_pool);
+        }
+
+        points.erase(std::unique(points.begin(), points.end()), points.end());
+
+        chain.clear();
+        if (points.size() <= 1)
+        {
+            chain = points;
+            return;
+        }
+
+        // Collinear points are dropped, only the corners remain
+        for (uint32_t tank : points)
+        {
+            while (chain.size() >= 2 && cross(positions[chain[chain.size() - 2]], positions[chain.back()], positions[tank]) <= 0) chain.pop_back();
+            chain.push_back(tank);
+        }
+
+        const size_t lower_size = chain.size() + 1;
+        for (size_t i = points.size() - 1; i-- > 0;)
+        {
+            uint32_t tank = points[i];
+            while (chain.size() >= lower_size && cross(positions[chain[chain.size() - 2]], positions[chain.back()], positions[tank]) <= 0) chain.pop_back();
+            chain.push_back(tank);
+        }
+
+        // The upper hull ends at the first point again
+        chain.pop_back();
+    }
+
+} // namespace Tmpl8
@@ -0,0 +1,74 @@
+#pragma once
+
+namespace Tmpl8 {
+
+    // Convex hull around all active tanks, used as the forcefield that stops rockets
+    // Andrew's monotone chain runs over a candidate set that is filtered in parallel with the grid:
+    // the tanks of last frame's hull span a polygon inside this frame's hull, so the grid cells
+    // entirely inside that polygon can't hold a hull vertex and are skipped
+    class ForcefieldHull
+    {
+    public:
+        // Recompute the hull around all active tanks, the grid has to hold the current tank positions
+        // In incremental mode the hull is only rebuilt when one of its vertex tanks moved or died,
+        // or another tank ended up outside of it
+        void update(const TankStore& tanks, const Grid& grid, ThreadPool& thread_pool);
+
+        void set_incremental(bool enabled) { incremental = enabled; }
+
+        // Hull points in counter clockwise order, without repeating the first point
+        const std::vector<vec2>& points() const { return hull; }
+
+        bool empty() const { return hull.empty(); }
+        size_t size() const { return hull.size(); }
+        const vec2& operator[](size_t index) const { return hull[index]; }
+
+        // Find the active rockets whose outline crosses the hull outline, in rocket order
+        // Same result as circle_segment_intersect against every edge, but without square roots or divisions:
+        // rockets outside the bounding box of the hull are rejected first, the others are tested 8 (AVX2) or 4 (SSE) at a time
+        void find_rocket_collisions(const RocketPool& rockets, ThreadPool& thread_pool, std::vector<uint32_t>& hit_rockets);
+
+    private:
+        static constexpr int rows_per_task = 4;
+        static constexpr size_t rockets_per_task = 256;
+
+        // Hull edge with the terms of the circle segment test that don't depend on the circle
+        struct Edge
+        {
+            float start_x, start_y;
+            float direction_x, direction_y;
+            float length_squared;
+        };
+
+        // Lane masks of the rockets that touch the edge, lanes are bits
+        static uint32_t test_rockets(const Edge& edge, const float* xs, const float* ys, const float* radii, size_t count);
+
+        void collect_candidates(const TankStore& tanks, const Grid& grid, ThreadPool& thread_pool);
+        bool is_unchanged(const TankStore& tanks) const;
+
+        // Monotone chain over the given tanks, the resulting tank indices are written to chain
+        void build_chain(const TankStore& tanks, std::vector<uint32_t>& points, ThreadPool& thread_pool);
+
+        bool incremental = false;
+
+        static constexpr size_t radix_sort_min_points = 1024;
+
+        std::vector<vec2> hull;
+        std::vector<uint32_t> hull_tanks; // Tank of every hull point
+        std::vector<Edge> edges;
+        vec2 bounds_min, bounds_max;
+
+        // Hull of the current positions of last frame's hull tanks
+        std::vector<vec2> inner_hull;
+        std::vector<uint32_t> inner_hull_tanks;
+
+        // Scratch buffers, kept between frames to avoid allocations
+        std::vector<std::vector<uint32_t>> task_candidates;
+        std::vector<uint32_t> candidates;
+        std::vector<uint32_t> chain;
+        std::vector<uint32_t> sort_keys;
+        RadixSort radix_sort;
+        std::vector<std::vector<uint32_t>> task_hits;
+    };
+
+} // namespace Tmpl8
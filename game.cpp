@@ -1,8 +1,5 @@
 #include "precomp.h" // include (only) this in every .cpp file
 
-constexpr auto num_tanks_blue = 2048;
-constexpr auto num_tanks_red = 2048;
-
 constexpr auto tank_max_health = 1000;
 constexpr auto rocket_hit_value = 60;
 constexpr auto particle_beam_hit_value = 50;
@@ -41,6 +38,21 @@ const static vec2 rocket_size(6, 6);
 const static float tank_radius = 3.f;
 const static float rocket_radius = 5.f;
 
+//Names of the update phases, used for the console report and the profiler spans
+const char* Game::phase_names[NUM_PHASES] = {
+    "initial routes",
+    "tank collisions",
+    "update tanks",
+    "grid rebuild",
+    "smoke plumes",
+    "forcefield hull",
+    "rockets",
+    "forcefield collisions",
+    "rocket compaction",
+    "particle beams",
+    "explosions"
+};
+
 // -----------------------------------------------------------
 // Initialize the simulation state
 // This function does not count for the performance multiplier
@@ -54,14 +66,16 @@ void Game::init()
     unsigned int num_threads = std::thread::hardware_concurrency();
     // Use at least 2 threads, but no more than what's available
     num_threads = std::max(2u, num_threads);
+    if (settings.num_threads >= 0) num_threads = (unsigned int)settings.num_threads;
 
     // Create thread pool with the appropriate number of threads
     thread_pool = new ThreadPool(num_threads);
+    build_update_graph();
 
-    grid = new Grid(SCRWIDTH, SCRHEIGHT, 20.0f);
-    tanks.reserve(num_tanks_blue + num_tanks_red);
+    if (settings.terrain_file) terrain_load_ok = background_terrain.load(settings.terrain_file);
 
-    uint max_rows = 24;
+    grid = new Grid(SCRWIDTH, SCRHEIGHT, 20.0f);
+    tanks.reserve(settings.num_tanks_blue + settings.num_tanks_red);
 
     float start_blue_x = tank_size.x + 40.0f;
     float start_blue_y = tank_size.y + 30.0f;
@@ -69,24 +83,47 @@ void Game::init()
     float start_red_x = 1088.0f;
     float start_red_y = tank_size.y + 30.0f;
 
-    float spacing = 7.5f;
-
     //Spawn blue tanks
-    for (int i = 0; i < num_tanks_blue; i++)
+    for (int i = 0; i < settings.num_tanks_blue; i++)
     {
-        vec2 position{ start_blue_x + ((i % max_rows) * spacing), start_blue_y + ((i / max_rows) * spacing) };
-        tanks.push_back(Tank(position.x, position.y, BLUE, &tank_blue, &smoke, 1100.f, position.y + 16, tank_radius, tank_max_health, tank_max_speed));
+        vec2 position = vec2(start_blue_x, start_blue_y) + formation_offset(i, settings.num_tanks_blue);
+        tanks.add(position, BLUE, &tank_blue, vec2(1100.f, position.y + 16), tank_radius, tank_max_health, tank_max_speed);
     }
     //Spawn red tanks
-    for (int i = 0; i < num_tanks_red; i++)
+    for (int i = 0; i < settings.num_tanks_red; i++)
     {
-        vec2 position{ start_red_x + ((i % max_rows) * spacing), start_red_y + ((i / max_rows) * spacing) };
-        tanks.push_back(Tank(position.x, position.y, RED, &tank_red, &smoke, 100.f, position.y + 16, tank_radius, tank_max_health, tank_max_speed));
+        vec2 position = vec2(start_red_x, start_red_y) + formation_offset(i, settings.num_tanks_red);
+        tanks.add(position, RED, &tank_red, vec2(100.f, position.y + 16), tank_radius, tank_max_health, tank_max_speed);
     }
 
     particle_beams.push_back(Particle_beam(vec2(590, 327), vec2(100, 50), &particle_beam_sprite, particle_beam_hit_value));
     particle_beams.push_back(Particle_beam(vec2(64, 64), vec2(100, 50), &particle_beam_sprite, particle_beam_hit_value));
     particle_beams.push_back(Particle_beam(vec2(1200, 600), vec2(100, 50), &particle_beam_sprite, particle_beam_hit_value));
+
+    //The grid is rebuilt after the tanks move, the first frame needs it before that
+    grid->add_tanks(tanks);
+}
+
+// -----------------------------------------------------------
+// Position of a tank in its army's starting formation, relative to the top left corner
+// Armies up to the reference size stand in rows of 24 tanks. Larger armies are packed
+// tighter, so they still fill the same area instead of running off the screen
+// -----------------------------------------------------------
+vec2 Game::formation_offset(int index, int army_size)
+{
+    const int reference_army_size = 2048;
+
+    float spacing = 7.5f;
+    int max_rows = 24;
+
+    if (army_size > reference_army_size)
+    {
+        float scale = sqrtf((float)army_size / reference_army_size);
+        max_rows = (int)ceilf(max_rows * scale);
+        spacing /= scale;
+    }
+
+    return vec2((index % max_rows) * spacing, (index / max_rows) * spacing);
 }
 
 // -----------------------------------------------------------
@@ -95,27 +132,32 @@ void Game::init()
 void Game::shutdown()
 {
     delete thread_pool;
+
+    if (trace_file && Profiler::get())
+    {
+        Profiler::get()->write_chrome_trace(trace_file);
+    }
 }
 
 // -----------------------------------------------------------
 // Iterates through all tanks and returns the closest enemy tank for the given tank
 // -----------------------------------------------------------
-Tank& Game::find_closest_enemy(Tank& current_tank)
+Tank Game::find_closest_enemy(Tank& current_tank)
 {
     // Use the grid to find the nearest enemy
-    Tank* enemy = grid->find_closest_enemy(current_tank);
+    int enemy = grid->find_closest_enemy(tanks, current_tank.get_index());
 
     // If no enemy is found (shouldn't happen), fall back to the old method
-    if (enemy == nullptr) {
+    if (enemy == -1) {
         // Fallback on original method
         float closest_distance = numeric_limits<float>::infinity();
-        int closest_index = 0;
+        size_t closest_index = 0;
 
-        for (int i = 0; i < tanks.size(); i++)
+        for (size_t i = 0; i < tanks.size(); i++)
         {
-            if (tanks.at(i).allignment != current_tank.allignment && tanks.at(i).active)
+            if (tanks.alignments[i] != current_tank.allignment() && tanks.active[i])
             {
-                float sqr_dist = fabsf((tanks.at(i).get_position() - current_tank.get_position()).sqr_length());
+                float sqr_dist = fabsf((tanks.positions[i] - current_tank.get_position()).sqr_length());
                 if (sqr_dist < closest_distance)
                 {
                     closest_distance = sqr_dist;
@@ -124,17 +166,11 @@ Tank& Game::find_closest_enemy(Tank& current_tank)
             }
         }
 
-        return tanks.at(closest_index);
+        return tanks[closest_index];
     }
 
     // Otherwise, return the enemy you found
-    return *enemy;
-}
-
-//Checks if a point lies on the left of an arbitrary angled line
-bool Tmpl8::Game::left_of_line(vec2 line_start, vec2 line_end, vec2 point)
-{
-    return ((line_end.x - line_start.x) * (point.y - line_start.y) - (line_end.y - line_start.y) * (point.x - line_start.x)) < 0;
+    return tanks[enemy];
 }
 
 // -----------------------------------------------------------
@@ -142,14 +178,18 @@ bool Tmpl8::Game::left_of_line(vec2 line_start, vec2 line_end, vec2 point)
 // -----------------------------------------------------------
 void Game::calculate_initial_routes()
 {
-    for (Tank& t : tanks)
+    // Tanks with the same destination share one flow field (one per team),
+    // instead of running a separate search per tank
+    for (size_t i = 0; i < tanks.size(); i++)
     {
-        t.set_route(background_terrain.get_route(t, t.target));
+        Tank t = tanks[i];
+        t.set_flow_field(background_terrain, background_terrain.get_flow_field(t.target()));
     }
 }
 
 // -----------------------------------------------------------
 // Handle tank collisions and push tanks away from each other
+// (uses the grid built after the tanks moved last frame)
 // -----------------------------------------------------------
 void Game::handle_tank_collisions()
 {
@@ -161,49 +201,46 @@ void Game::handle_tank_collisions()
 // -----------------------------------------------------------
 void Game::update_tanks()
 {
-    const size_t num_tanks = tanks.size();
     const size_t tanks_per_thread = 64; // Adjust batch size for better performance
 
-    std::vector<std::future<void>> futures;
-
-    // Process tanks in batches to reduce thread creation overhead
-    for (size_t i = 0; i < num_tanks; i += tanks_per_thread)
-    {
-        size_t end = std::min(i + tanks_per_thread, num_tanks);
-
-        futures.push_back(thread_pool->enqueue([this, i, end]() {
-            for (size_t j = i; j < end; j++)
+    // Move all tanks first, so every tank aims at the new positions no matter which batch moved first
+    thread_pool->parallel_for(0, tanks.size(), tanks_per_thread, [this](size_t begin, size_t end) {
+            for (size_t j = begin; j < end; j++)
             {
-                Tank& tank = tanks[j];
-                if (!tank.active) continue;
+                Tank tank = tanks[j];
+                if (!tank.active()) continue;
 
                 // Move tanks according to speed and nudges, also reload
                 tank.tick(background_terrain);
+            }
+        });
+
+    // Every batch spawns its rockets into its own buffer, so no lock is needed
+    rockets.begin_spawning((tanks.size() + tanks_per_thread - 1) / tanks_per_thread);
+
+    thread_pool->parallel_for(0, tanks.size(), tanks_per_thread, [this, tanks_per_thread](size_t begin, size_t end) {
+            for (size_t j = begin; j < end; j++)
+            {
+                Tank tank = tanks[j];
+                if (!tank.active()) continue;
 
                 // Shoot at closest target if reloaded
                 if (tank.rocket_reloaded())
                 {
-                    Tank& target = find_closest_enemy(tank);
+                    Tank target = find_closest_enemy(tank);
 
-                    // Protect rocket creation with a lock since we're modifying the rockets vector
-                    std::lock_guard<std::mutex> lock(tanks_mutex);
-                    rockets.push_back(Rocket(tank.position,
-                        (target.get_position() - tank.position).normalized() * 3,
+                    rockets.spawn(begin / tanks_per_thread, Rocket(tank.position(),
+                        (target.get_position() - tank.position()).normalized() * 3,
                         rocket_radius,
-                        tank.allignment,
-                        ((tank.allignment == RED) ? &rocket_red : &rocket_blue)));
+                        tank.allignment(),
+                        ((tank.allignment() == RED) ? &rocket_red : &rocket_blue)));
 
                     tank.reload_rocket();
                 }
             }
-            }));
-    }
+        });
 
-    // Wait for all threads to complete
-    for (auto& future : futures)
-    {
-        future.wait();
-    }
+    rockets.end_spawning();
 }
 
 // -----------------------------------------------------------
@@ -211,61 +248,7 @@ void Game::update_tanks()
 // -----------------------------------------------------------
 void Game::update_smoke_plumes()
 {
-    for (Smoke& smoke : smokes)
-    {
-        smoke.tick();
-    }
-}
-
-// -----------------------------------------------------------
-// Find the leftmost active tank to start the convex hull algorithm
-// -----------------------------------------------------------
-vec2 Game::find_leftmost_active_tank()
-{
-    vec2 leftmost_position;
-    bool first_found = false;
-
-    for (Tank& tank : tanks)
-    {
-        if (tank.active)
-        {
-            if (!first_found)
-            {
-                leftmost_position = tank.position;
-                first_found = true;
-            }
-            else if (tank.position.x <= leftmost_position.x)
-            {
-                leftmost_position = tank.position;
-            }
-        }
-    }
-
-    return leftmost_position;
-}
-
-// -----------------------------------------------------------
-// Check if there's at least one active tank in the game
-// -----------------------------------------------------------
-bool Game::has_active_tanks()
-{
-    for (Tank& tank : tanks)
-    {
-        if (tank.active) return true;
-    }
-    return false;
-}
-
-// -----------------------------------------------------------
-// Find the first active tank's index
-// -----------------------------------------------------------
-int Game::find_first_active_tank_index()
-{
-    for (size_t i = 0; i < tanks.size(); i++)
-    {
-        if (tanks[i].active) return i;
-    }
-    return -1;  // Return -1 if no active tank is found
+    smokes.tick();
 }
 
 // -----------------------------------------------------------
@@ -273,41 +256,7 @@ int Game::find_first_active_tank_index()
 // -----------------------------------------------------------
 void Game::calculate_forcefield_hull()
 {
-    forcefield_hull.clear();
-
-    // Quick check if there are any active tanks
-    if (!has_active_tanks()) return;
-
-    // Find leftmost tank position to start convex hull
-    vec2 point_on_hull = find_leftmost_active_tank();
-    forcefield_hull.push_back(point_on_hull);
-
-    // Get reference point for comparison
-    int first_active_idx = find_first_active_tank_index();
-    if (first_active_idx == -1) return;  // Safety check
-
-    // Gift wrapping algorithm (Jarvis march)
-    while (true)
-    {
-        vec2 endpoint = tanks[first_active_idx].position;
-
-        for (Tank& tank : tanks)
-        {
-            if (!tank.active) continue;
-
-            if ((endpoint == point_on_hull) || left_of_line(point_on_hull, endpoint, tank.position))
-            {
-                endpoint = tank.position;
-            }
-        }
-
-        point_on_hull = endpoint;
-
-        // Check if we've completed the hull
-        if (endpoint == forcefield_hull[0]) break;
-
-        forcefield_hull.push_back(point_on_hull);
-    }
+    forcefield_hull.update(tanks, *grid, *thread_pool);
 }
 
 // -----------------------------------------------------------
@@ -315,46 +264,31 @@ void Game::calculate_forcefield_hull()
 // -----------------------------------------------------------
 void Game::update_rockets_tank_collisions()
 {
-    const size_t num_rockets = rockets.size();
-    std::vector<std::future<void>> futures;
-
-    // Process rockets in parallel
-    for (size_t i = 0; i < num_rockets; i++)
-    {
-        futures.push_back(thread_pool->enqueue([this, i]() {
-            Rocket& rocket = rockets[i];
-            if (!rocket.active) return;
+    const size_t rockets_per_thread = 64; // Rockets only test a few grid cells, so batch them like the tanks
 
-            rocket.tick();
+    // Hits are recorded per chunk and applied after all rockets moved, so no lock is needed
+    tank_hits.begin((rockets.size() + rockets_per_thread - 1) / rockets_per_thread);
 
-            // Check if rocket collides with enemy tank
-            for (Tank& tank : tanks)
+    // Process rockets in parallel
+    thread_pool->parallel_for(0, rockets.size(), rockets_per_thread, [this, rockets_per_thread](size_t begin, size_t end) {
+            for (size_t j = begin; j < end; j++)
             {
-                if (!tank.active || tank.allignment == rocket.allignment) continue;
-
-                if (rocket.intersects(tank.position, tank.collision_radius))
-                {
-                    // Need to protect access to explosions and smokes vectors
-                    std::lock_guard<std::mutex> lock(tanks_mutex);
-                    explosions.push_back(Explosion(&explosion, tank.position));
+                Rocket& rocket = rockets[j];
+                if (!rocket.active) continue;
 
-                    if (tank.hit(rocket_hit_value))
-                    {
-                        smokes.push_back(Smoke(smoke, tank.position - vec2(7, 24)));
-                    }
+                rocket.tick();
 
+                // Check if rocket collides with enemy tank, only looking at the grid cells around it
+                int hit_tank = grid->find_rocket_collision(tanks, rocket.position, rocket.collision_radius, rocket.allignment);
+                if (hit_tank != -1)
+                {
+                    tank_hits.push(begin / rockets_per_thread, TankHit{ (uint32_t)hit_tank, rocket_hit_value, true });
                     rocket.active = false;
-                    break;
                 }
             }
-            }));
-    }
+        });
 
-    // Wait for all collision detection to complete
-    for (auto& future : futures)
-    {
-        future.wait();
-    }
+    apply_tank_hits(vec2(7, 24));
 }
 
 // -----------------------------------------------------------
@@ -362,37 +296,23 @@ void Game::update_rockets_tank_collisions()
 // -----------------------------------------------------------
 void Game::check_rockets_forcefield_collisions()
 {
-    if (forcefield_hull.empty()) return;
+    // The hull tests the rockets in parallel, the explosions are added afterwards in rocket order
+    forcefield_hull.find_rocket_collisions(rockets, *thread_pool, forcefield_hits);
 
-    for (Rocket& rocket : rockets)
+    for (uint32_t hit : forcefield_hits)
     {
-        if (!rocket.active) continue;
-
-        for (size_t i = 0; i < forcefield_hull.size(); i++)
-        {
-            if (circle_segment_intersect(
-                forcefield_hull.at(i),
-                forcefield_hull.at((i + 1) % forcefield_hull.size()),
-                rocket.position,
-                rocket.collision_radius))
-            {
-                explosions.push_back(Explosion(&explosion, rocket.position));
-                rocket.active = false;
-                break;
-            }
-        }
+        Rocket& rocket = rockets[hit];
+        explosions.spawn(rocket.position);
+        rocket.active = false;
     }
 }
 
 // -----------------------------------------------------------
-// Remove inactive rockets
+// Remove inactive rockets and rockets that left the screen
 // -----------------------------------------------------------
 void Game::remove_inactive_rockets()
 {
-    rockets.erase(
-        std::remove_if(rockets.begin(), rockets.end(),
-            [](const Rocket& rocket) { return !rocket.active; }),
-        rockets.end());
+    rockets.remove_inactive();
 }
 
 // -----------------------------------------------------------
@@ -400,36 +320,47 @@ void Game::remove_inactive_rockets()
 // -----------------------------------------------------------
 void Game::update_particle_beams()
 {
-    std::vector<std::future<void>> futures;
+    // One beam per task, every beam scans all tanks and records its hits
+    tank_hits.begin(particle_beams.size());
 
-    for (size_t i = 0; i < particle_beams.size(); i++)
-    {
-        futures.push_back(thread_pool->enqueue([this, i]() {
+    thread_pool->parallel_for(0, particle_beams.size(), 1, [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
             Particle_beam& particle_beam = particle_beams[i];
             particle_beam.tick(tanks);
 
             // Damage all tanks within the beam's damage window
-            for (Tank& tank : tanks)
+            for (size_t t = 0; t < tanks.size(); t++)
             {
-                if (!tank.active) continue;
+                if (!tanks.active[t]) continue;
 
-                if (particle_beam.rectangle.intersects_circle(tank.get_position(), tank.get_collision_radius()))
+                if (particle_beam.rectangle.intersects_circle(tanks.positions[t], tanks.collision_radii[t]))
                 {
-                    if (tank.hit(particle_beam.damage))
-                    {
-                        // Need to protect access to the smokes vector
-                        std::lock_guard<std::mutex> lock(tanks_mutex);
-                        smokes.push_back(Smoke(smoke, tank.position - vec2(0, 48)));
-                    }
+                    tank_hits.push(i, TankHit{ (uint32_t)t, particle_beam.damage, false });
                 }
             }
-            }));
-    }
+        }
+    });
+
+    apply_tank_hits(vec2(0, 48));
+}
 
-    // Wait for all beam updates to complete
-    for (auto& future : futures)
+// -----------------------------------------------------------
+// Apply the hits recorded by a parallel phase, in the same order every run
+// The damage is summed per tank first, so a tank hit several times is only destroyed once
+// -----------------------------------------------------------
+void Game::apply_tank_hits(const vec2& smoke_offset)
+{
+    tank_hits.apply([this](const TankHit& hit) {
+        if (hit.explosion) explosions.spawn(tanks.positions[hit.tank]);
+        tanks.add_damage(hit.tank, hit.damage);
+    });
+
+    tanks.apply_damage(destroyed_tanks);
+
+    for (uint32_t tank : destroyed_tanks)
     {
-        future.wait();
+        smokes.spawn(tanks.positions[tank] - smoke_offset);
     }
 }
 
@@ -438,15 +369,7 @@ void Game::update_particle_beams()
 // -----------------------------------------------------------
 void Game::update_explosions()
 {
-    for (Explosion& explosion : explosions)
-    {
-        explosion.tick();
-    }
-
-    explosions.erase(
-        std::remove_if(explosions.begin(), explosions.end(),
-            [](const Explosion& explosion) { return explosion.done(); }),
-        explosions.end());
+    explosions.tick();
 }
 
 // -----------------------------------------------------------
@@ -454,113 +377,163 @@ void Game::update_explosions()
 // -----------------------------------------------------------
 void Game::update(float deltaTime)
 {
+    if (Profiler* profiler = Profiler::get()) profiler->begin_frame((uint32_t)frame_count);
+    ScopedTimer frame_timer("update");
+
     // Calculate routes only once at the beginning
     if (frame_count == 0)
     {
+        ScopedTimer phase_timer(phase_names[PHASE_ROUTES], &phase_durations[PHASE_ROUTES]);
         calculate_initial_routes();
     }
 
-    // Update the grid with the current tank positions
-    grid->add_tanks(tanks);
-
     // Handle tank collisions
-    handle_tank_collisions();
+    {
+        ScopedTimer phase_timer(phase_names[PHASE_TANK_COLLISIONS], &phase_durations[PHASE_TANK_COLLISIONS]);
+        handle_tank_collisions();
+    }
 
     // Update tanks in parallel
-    update_tanks();
+    {
+        ScopedTimer phase_timer(phase_names[PHASE_TANKS], &phase_durations[PHASE_TANKS]);
+        update_tanks();
+    }
 
-    // These can be done concurrently
-    auto smoke_future = thread_pool->enqueue([this]() { update_smoke_plumes(); });
-    auto forcefield_future = thread_pool->enqueue([this]() { calculate_forcefield_hull(); });
+    // Update the grid with the new tank positions, once per frame
+    // Rockets use it now, tank collisions and targeting use it next frame
+    // (tanks that die later this frame stay in the grid, but every query skips inactive tanks)
+    {
+        ScopedTimer phase_timer(phase_names[PHASE_GRID], &phase_durations[PHASE_GRID]);
+        grid->add_tanks(tanks);
+    }
 
-    // Update rockets and handle their collisions
-    update_rockets_tank_collisions();
+    // Rockets, forcefield, beams and effects, ordered by the dependencies between them
+    update_graph.run(*thread_pool);
 
-    // Wait for concurrent operations to complete
-    smoke_future.wait();
-    forcefield_future.wait();
+    if (hash_log) hash_log->frame(frame_count, state_hash());
+}
 
-    // Check rockets against forcefield
-    check_rockets_forcefield_collisions();
+// -----------------------------------------------------------
+// Hash everything that influences the next frames, in a fixed order
+// Sprites are left out, their pointers differ from run to run
+// -----------------------------------------------------------
+uint64_t Game::state_hash()
+{
+    StateHash hash;
+
+    hash.add(tanks.positions);
+    hash.add(tanks.speeds);
+    hash.add(tanks.targets);
+    hash.add(tanks.health);
+    hash.add(tanks.reload_times);
+    hash.add(tanks.reloaded);
+    hash.add(tanks.active);
+    hash.add(tanks.current_frames);
+    hash.add(tanks.flow_fields);
+
+    hash.add(rockets.size());
+    for (const Rocket& rocket : rockets)
+    {
+        hash.add(rocket.position);
+        hash.add(rocket.speed);
+        hash.add(rocket.active);
+        hash.add(rocket.allignment);
+    }
 
-    // Clean up inactive rockets
-    remove_inactive_rockets();
+    smokes.add_to_hash(hash);
+    explosions.add_to_hash(hash);
 
-    // Update particle beams
-    update_particle_beams();
+    return hash.value();
+}
 
-    // Update explosions
-    update_explosions();
+// -----------------------------------------------------------
+// Build the task graph for the second half of the update
+// The forcefield hull runs next to the smoke plumes and is done before rockets can
+// destroy tanks, the smoke plumes are ticked before rockets add new ones. Rocket compaction, beams and explosions only wait for
+// the phases that touch the same data.
+// -----------------------------------------------------------
+void Game::build_update_graph()
+{
+    auto phase = [this](update_phases phase, void (Game::*update_function)()) {
+        return update_graph.add([this, phase, update_function]() {
+            ScopedTimer phase_timer(phase_names[phase], &phase_durations[phase]);
+            (this->*update_function)();
+        });
+    };
+
+    size_t forcefield_hull = phase(PHASE_FORCEFIELD_HULL, &Game::calculate_forcefield_hull);
+    size_t smoke_plumes = phase(PHASE_SMOKE, &Game::update_smoke_plumes);
+    size_t rockets = phase(PHASE_ROCKETS, &Game::update_rockets_tank_collisions);
+    size_t forcefield_collisions = phase(PHASE_FORCEFIELD_COLLISIONS, &Game::check_rockets_forcefield_collisions);
+    size_t rocket_compaction = phase(PHASE_ROCKET_COMPACTION, &Game::remove_inactive_rockets);
+    size_t beams = phase(PHASE_PARTICLE_BEAMS, &Game::update_particle_beams);
+    size_t explosions = phase(PHASE_EXPLOSIONS, &Game::update_explosions);
+
+    update_graph.add_dependency(rockets, smoke_plumes);
+    update_graph.add_dependency(rockets, forcefield_hull);
+    update_graph.add_dependency(forcefield_collisions, rockets);
+    update_graph.add_dependency(rocket_compaction, forcefield_collisions);
+    update_graph.add_dependency(explosions, forcefield_collisions);
+    update_graph.add_dependency(beams, rockets);
 }
 
 // -----------------------------------------------------------
 // Draw all sprites to the screen
-// (It is not recommended to multi-thread this function)
+// The draws are recorded in draw order, tick_draw rasterizes them per screen tile on the thread pool,
+// every tile applies the draws that overlap it in the same order, so the frame matches a serial draw
 // -----------------------------------------------------------
 void Game::draw()
 {
     // clear the graphics window
-    screen->clear(0);
+    renderer.begin(0);
 
     //Draw background
-    background_terrain.draw(screen);
+    background_terrain.draw(renderer);
 
     //Draw sprites
-    for (int i = 0; i < num_tanks_blue + num_tanks_red; i++)
+    for (size_t i = 0; i < tanks.size(); i++)
     {
-        tanks.at(i).draw(screen);
-
-        vec2 tank_pos = tanks.at(i).get_position();
+        tanks[i].draw(renderer);
     }
 
     for (Rocket& rocket : rockets)
     {
-        rocket.draw(screen);
+        rocket.draw(renderer);
     }
 
-    for (Smoke& smoke : smokes)
-    {
-        smoke.draw(screen);
-    }
+    smokes.draw(renderer, smoke);
 
     for (Particle_beam& particle_beam : particle_beams)
     {
-        particle_beam.draw(screen);
+        particle_beam.draw(renderer);
     }
 
-    for (Explosion& explosion : explosions)
-    {
-        explosion.draw(screen);
-    }
+    explosions.draw(renderer, explosion);
 
     //Draw forcefield (mostly for debugging, its kinda ugly..)
     for (size_t i = 0; i < forcefield_hull.size(); i++)
     {
-        vec2 line_start = forcefield_hull.at(i);
-        vec2 line_end = forcefield_hull.at((i + 1) % forcefield_hull.size());
+        vec2 line_start = forcefield_hull[i];
+        vec2 line_end = forcefield_hull[(i + 1) % forcefield_hull.size()];
         line_start.x += HEALTHBAR_OFFSET;
         line_end.x += HEALTHBAR_OFFSET;
-        screen->line(line_start, line_end, 0x0000ff);
+        renderer.draw_line(line_start, line_end, 0x0000ff);
     }
 
     //Draw sorted health bars
     for (int t = 0; t < 2; t++)
     {
-        const int NUM_TANKS = ((t < 1) ? num_tanks_blue : num_tanks_red);
-
-        const int begin = ((t < 1) ? 0 : num_tanks_blue);
-        std::vector<const Tank*> sorted_tanks;
-        MergeSort::sort_tanks_health(tanks, sorted_tanks, begin, begin + NUM_TANKS);
-        sorted_tanks.erase(std::remove_if(sorted_tanks.begin(), sorted_tanks.end(), [](const Tank* tank) { return !tank->active; }), sorted_tanks.end());
+        //Only the least healthy tanks get a bar, read them from the health histogram of the team
+        tanks.health_ranking.lowest(t, SCRHEIGHT, health_bar_values);
 
-        draw_health_bars(sorted_tanks, t);
+        draw_health_bars(health_bar_values, t);
     }
 }
 
 // -----------------------------------------------------------
 // Draw the health bars based on the given tanks health values
 // -----------------------------------------------------------
-void Tmpl8::Game::draw_health_bars(const std::vector<const Tank*>& sorted_tanks, const int team)
+void Tmpl8::Game::draw_health_bars(const std::vector<int>& sorted_health, const int team)
 {
     int health_bar_start_x = (team < 1) ? 0 : (SCRWIDTH - HEALTHBAR_OFFSET) - 1;
     int health_bar_end_x = (team < 1) ? health_bar_width : health_bar_start_x + health_bar_width - 1;
@@ -571,21 +544,21 @@ void Tmpl8::Game::draw_health_bars(const std::vector<const Tank*>& sorted_tanks,
         int health_bar_start_y = i * 1;
         int health_bar_end_y = health_bar_start_y + 1;
 
-        screen->bar(health_bar_start_x, health_bar_start_y, health_bar_end_x, health_bar_end_y, REDMASK);
+        renderer.draw_bar(health_bar_start_x, health_bar_start_y, health_bar_end_x, health_bar_end_y, REDMASK);
     }
 
     //Draw the <SCRHEIGHT> least healthy tank health bars
-    int draw_count = std::min(SCRHEIGHT, (int)sorted_tanks.size());
+    int draw_count = std::min(SCRHEIGHT, (int)sorted_health.size());
     for (int i = 0; i < draw_count - 1; i++)
     {
         //Health bars are 1 pixel each
         int health_bar_start_y = i * 1;
         int health_bar_end_y = health_bar_start_y + 1;
 
-        float health_fraction = (1 - ((double)sorted_tanks.at(i)->health / (double)tank_max_health));
+        float health_fraction = (1 - ((double)sorted_health[i] / (double)tank_max_health));
 
-        if (team == 0) { screen->bar(health_bar_start_x + (int)((double)health_bar_width * health_fraction), health_bar_start_y, health_bar_end_x, health_bar_end_y, GREENMASK); }
-        else { screen->bar(health_bar_start_x, health_bar_start_y, health_bar_end_x - (int)((double)health_bar_width * health_fraction), health_bar_end_y, GREENMASK); }
+        if (team == 0) { renderer.draw_bar(health_bar_start_x + (int)((double)health_bar_width * health_fraction), health_bar_start_y, health_bar_end_x, health_bar_end_y, GREENMASK); }
+        else { renderer.draw_bar(health_bar_start_x, health_bar_start_y, health_bar_end_x - (int)((double)health_bar_width * health_fraction), health_bar_end_y, GREENMASK); }
     }
 }
 
@@ -611,12 +584,136 @@ void Tmpl8::Game::measure_performance()
 
     if (lock_update)
     {
-        screen->bar(420 + HEALTHBAR_OFFSET, 170, 870 + HEALTHBAR_OFFSET, 430, 0x030000);
+        renderer.draw_bar(420 + HEALTHBAR_OFFSET, 170, 870 + HEALTHBAR_OFFSET, 430, 0x030000);
         int ms = (int)duration % 1000, sec = ((int)duration / 1000) % 60, min = ((int)duration / 60000);
         sprintf(buffer, "%02i:%02i:%03i", min, sec, ms);
-        frame_count_font->centre(screen, buffer, 200);
+        renderer.draw_text(frame_count_font, buffer, (SCRWIDTH - frame_count_font->width(buffer)) / 2, 200);
         sprintf(buffer, "SPEEDUP: %4.1f", REF_PERFORMANCE / duration);
-        frame_count_font->centre(screen, buffer, 340);
+        renderer.draw_text(frame_count_font, buffer, (SCRWIDTH - frame_count_font->width(buffer)) / 2, 340);
+    }
+}
+
+// -----------------------------------------------------------
+// Nearest rank percentile of sorted values
+// -----------------------------------------------------------
+static float percentile(const std::vector<float>& sorted_values, float fraction)
+{
+    if (sorted_values.empty()) return 0.f;
+
+    size_t rank = (size_t)ceilf(fraction * sorted_values.size());
+    return sorted_values[std::clamp<size_t>(rank, 1, sorted_values.size()) - 1];
+}
+
+// -----------------------------------------------------------
+// Headless batch mode: run a fixed number of frames without drawing
+// Nothing touches SDL or the screen surface, so this also works without a display
+// -----------------------------------------------------------
+void Game::run_headless(int num_frames)
+{
+    if (num_frames <= 0) num_frames = max_frames;
+
+    phase_durations.fill(0.f);
+    frame_durations.clear();
+    frame_durations.reserve(num_frames);
+    perf_timer.reset();
+
+    timer frame_timer;
+    for (int i = 0; i < num_frames; i++)
+    {
+        //Frame time is fixed so every run simulates the exact same frames
+        frame_timer.reset();
+        update(1000.f / 60.f);
+        frame_durations.push_back(frame_timer.elapsed());
+        frame_count++;
+    }
+
+    duration = perf_timer.elapsed();
+    print_phase_durations(num_frames, duration);
+}
+
+// -----------------------------------------------------------
+// Report of the last headless run, for comparing army sizes and thread counts
+// -----------------------------------------------------------
+bool Game::write_benchmark_report(const char* file_path) const
+{
+    std::vector<float> sorted_durations = frame_durations;
+    std::sort(sorted_durations.begin(), sorted_durations.end());
+
+    const size_t num_frames = frame_durations.size();
+    const float mean = num_frames ? duration / num_frames : 0.f;
+
+    const char* value_names[] = { "blue_tanks", "red_tanks", "threads", "frames", "total_ms", "mean_ms", "p50_ms", "p90_ms", "p99_ms", "max_ms" };
+    const float values[] = { (float)settings.num_tanks_blue, (float)settings.num_tanks_red, (float)thread_pool->num_threads(), (float)num_frames, duration, mean,
+                             percentile(sorted_durations, 0.5f), percentile(sorted_durations, 0.9f), percentile(sorted_durations, 0.99f), percentile(sorted_durations, 1.f) };
+    const size_t num_values = sizeof(values) / sizeof(values[0]);
+
+    const std::string path(file_path);
+    const bool json = (path.size() >= 5) && (path.compare(path.size() - 5, 5, ".json") == 0);
+    const bool new_file = json || !std::filesystem::exists(path);
+
+    std::ofstream report(path, json ? std::ios::trunc : std::ios::app);
+    if (!report.is_open())
+    {
+        std::cout << "Could not open report file: " << file_path << std::endl;
+        return false;
+    }
+
+    if (json)
+    {
+        report << "{";
+        for (size_t i = 0; i < num_values; i++) report << "\"" << value_names[i] << "\":" << values[i] << ",";
+        report << "\"phase_ms_per_frame\":{";
+        for (int i = 0; i < NUM_PHASES; i++)
+        {
+            report << "\"" << phase_names[i] << "\":" << (num_frames ? phase_durations[i] / num_frames : 0.f) << ((i + 1 < NUM_PHASES) ? "," : "");
+        }
+        report << "}}\n";
+    }
+    else
+    {
+        //Phase columns are the phase names with underscores, in ms per frame
+        if (new_file)
+        {
+            for (size_t i = 0; i < num_values; i++) report << value_names[i] << ",";
+            for (int i = 0; i < NUM_PHASES; i++)
+            {
+                std::string name = phase_names[i];
+                std::replace(name.begin(), name.end(), ' ', '_');
+                report << name << ((i + 1 < NUM_PHASES) ? "," : "\n");
+            }
+        }
+
+        for (size_t i = 0; i < num_values; i++) report << values[i] << ",";
+        for (int i = 0; i < NUM_PHASES; i++)
+        {
+            report << (num_frames ? phase_durations[i] / num_frames : 0.f) << ((i + 1 < NUM_PHASES) ? "," : "\n");
+        }
+    }
+
+    std::cout << "Wrote benchmark report to " << file_path << std::endl;
+    return true;
+}
+
+// -----------------------------------------------------------
+// Print the accumulated time of each update phase to the console
+// Some phases run concurrently (smoke next to the forcefield hull, beams next
+// to the forcefield collisions), so the percentages can add up to more than 100
+// -----------------------------------------------------------
+void Game::print_phase_durations(int num_frames, float total_duration) const
+{
+    char buffer[128];
+    sprintf(buffer, "Headless run: %i frames in %.1f ms (%.3f ms/frame)", num_frames, total_duration, total_duration / num_frames);
+    cout << buffer << endl;
+
+    std::vector<float> sorted_durations = frame_durations;
+    std::sort(sorted_durations.begin(), sorted_durations.end());
+    sprintf(buffer, "  frame time p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms", percentile(sorted_durations, 0.5f), percentile(sorted_durations, 0.9f), percentile(sorted_durations, 0.99f), percentile(sorted_durations, 1.f));
+    cout << buffer << endl;
+
+    for (int i = 0; i < NUM_PHASES; i++)
+    {
+        sprintf(buffer, "  %-22s %10.1f ms %9.3f ms/frame %5.1f%%", phase_names[i], phase_durations[i], phase_durations[i] / num_frames, 100.f * phase_durations[i] / total_duration);
+        cout << buffer << endl;
     }
 }
 
@@ -624,11 +721,40 @@ void Tmpl8::Game::measure_performance()
 // Main application tick function
 // -----------------------------------------------------------
 void Game::tick(float deltaTime)
+{
+    tick_update(deltaTime);
+    tick_draw();
+}
+
+// -----------------------------------------------------------
+// Update half of the tick, it doesn't touch the screen
+// -----------------------------------------------------------
+void Game::tick_update(float deltaTime)
 {
     if (!lock_update)
     {
         update(deltaTime);
     }
+}
+
+// -----------------------------------------------------------
+// Start tick_update as a task on the thread pool, the calling thread is free until wait_for_update
+// -----------------------------------------------------------
+void Game::start_update(float deltaTime)
+{
+    thread_pool->run(update_group, [this, deltaTime]() { tick_update(deltaTime); });
+}
+
+void Game::wait_for_update()
+{
+    thread_pool->wait(update_group);
+}
+
+// -----------------------------------------------------------
+// Draw half of the tick, the screen is only written, never read
+// -----------------------------------------------------------
+void Game::tick_draw()
+{
     draw();
 
     measure_performance();
@@ -642,5 +768,8 @@ void Game::tick(float deltaTime)
     //Print frame count
     frame_count++;
     string frame_count_string = "FRAME: " + std::to_string(frame_count);
-    frame_count_font->print(screen, frame_count_string.c_str(), 350, 580);
+    renderer.draw_text(frame_count_font, frame_count_string.c_str(), 350, 580);
+
+    //Rasterize everything recorded this frame
+    renderer.render(screen, *thread_pool);
 }
\ No newline at end of file
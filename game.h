@@ -5,22 +5,57 @@ namespace Tmpl8
 //forward declarations
 class Tank;
 class Rocket;
-class Smoke;
 class Particle_beam;
 
+// Size of the armies, threading and map of a simulation, the defaults are the reference scenario
+struct GameSettings
+{
+    int num_tanks_blue = 2048;
+    int num_tanks_red = 2048;
+    int num_threads = -1;               // Worker threads, 0 runs everything on the calling thread, -1 uses one per core (at least 2)
+    const char* terrain_file = nullptr; // Terrain layout to load instead of assets/terrain.txt
+};
+
 class Game
 {
   public:
     void set_target(Surface* surface) { screen = surface; }
+    // Has to be called before init
+    void set_settings(const GameSettings& game_settings) { settings = game_settings; }
     void init();
+    // False if init could not load the terrain file of the settings, the map is all grass then
+    bool terrain_loaded() const { return terrain_load_ok; }
     void shutdown();
     void update(float deltaTime);
     void draw();
     void tick(float deltaTime);
-    void draw_health_bars(const std::vector<const Tank*>& sorted_tanks, const int team);
+    // tick is tick_update followed by tick_draw, drawing only needs the screen while tick_draw runs
+    void tick_update(float deltaTime);
+    void tick_draw();
+    // Run tick_update on the thread pool, so the caller can present the last frame in the meantime
+    // Nothing else may be called on the game until wait_for_update returns
+    void start_update(float deltaTime);
+    void wait_for_update();
+    void draw_health_bars(const std::vector<int>& sorted_health, const int team);
     void measure_performance();
 
-    Tank& find_closest_enemy(Tank& current_tank);
+    // Run the simulation for a fixed number of frames without drawing and report per-phase timings
+    void run_headless(int num_frames);
+
+    // Write the frame time percentiles and per-phase costs of the last headless run
+    // A .json file gets one JSON object, any other file gets a CSV row appended (with a header if the file is new)
+    bool write_benchmark_report(const char* file_path) const;
+
+    // Write the profiler spans as a Chrome trace file on shutdown (only if the profiler is enabled)
+    void set_trace_file(const char* file_path) { trace_file = file_path; }
+
+    // Record or verify the state hash of every updated frame (nullptr disables it)
+    void set_hash_log(HashLog* log) { hash_log = log; }
+
+    // Hash of the tank, rocket and effect state, equal for equal simulations
+    uint64_t state_hash();
+
+    Tank find_closest_enemy(Tank& current_tank);
 
     void mouse_up(int button)
     { /* implement if you want to detect mouse button presses */
@@ -43,43 +78,83 @@ class Game
     }
 
   private:
+    // Update phases that are timed separately (see run_headless)
+    enum update_phases
+    {
+        PHASE_ROUTES,
+        PHASE_TANK_COLLISIONS,
+        PHASE_TANKS,
+        PHASE_GRID,
+        PHASE_SMOKE,
+        PHASE_FORCEFIELD_HULL,
+        PHASE_ROCKETS,
+        PHASE_FORCEFIELD_COLLISIONS,
+        PHASE_ROCKET_COMPACTION,
+        PHASE_PARTICLE_BEAMS,
+        PHASE_EXPLOSIONS,
+        NUM_PHASES
+    };
 
     ThreadPool* thread_pool;
-    std::mutex tanks_mutex; // For protecting tank updates
+    TaskGraph update_graph;
+    void build_update_graph();
 
+    static vec2 formation_offset(int index, int army_size);
     void calculate_initial_routes();
     void handle_tank_collisions();
     void update_tanks();
     void update_smoke_plumes();
-    vec2 find_leftmost_active_tank();
-    bool has_active_tanks();
-    int find_first_active_tank_index();
     void calculate_forcefield_hull();
     void update_rockets_tank_collisions();
     void check_rockets_forcefield_collisions();
     void remove_inactive_rockets();
     void update_particle_beams();
     void update_explosions();
+    void apply_tank_hits(const vec2& smoke_offset);
     Surface* screen;
+    TileRenderer renderer{ SCRWIDTH, SCRHEIGHT };   //Records the sprite draws of a frame and rasterizes them per screen tile
 
-    vector<Tank> tanks;
-    vector<Rocket> rockets;
-    vector<Smoke> smokes;
-    vector<Explosion> explosions;
+    TankStore tanks;
+    RocketPool rockets{ 8192, vec2(SCRWIDTH, SCRHEIGHT) };
+    EffectBuffer smokes{ 600, 15, 1024 };     //Smoke plumes of destroyed tanks, they fade after 10 seconds
+    EffectBuffer explosions{ 18, 2, 4096 };   //Explosions play their 9 frames once
     vector<Particle_beam> particle_beams;
 
     Grid* grid;
 
     Terrain background_terrain;
-    std::vector<vec2> forcefield_hull;
+    ForcefieldHull forcefield_hull;
+    std::vector<uint32_t> forcefield_hits; //Rockets that hit the forcefield this frame
+
+    //Damage dealt by a parallel phase, applied by apply_tank_hits once the phase is done
+    struct TankHit
+    {
+        uint32_t tank;
+        int damage;
+        bool explosion; //Rocket hits show an explosion on the tank
+    };
+    EventBuffer<TankHit> tank_hits;
+    std::vector<uint32_t> destroyed_tanks; //Tanks destroyed by the last apply_tank_hits
+
+    std::vector<int> health_bar_values; //Health of the tanks that get a bar this frame, reused every frame
 
     Font* frame_count_font;
     long long frame_count = 0;
 
     bool lock_update = false;
 
-    //Checks if a point lies on the left of an arbitrary angled line
-    bool left_of_line(vec2 line_start, vec2 line_end, vec2 point);
+    GameSettings settings;
+    bool terrain_load_ok = true;
+    TaskGroup update_group; //Update started by start_update
+
+    //Accumulated time per update phase in milliseconds
+    std::array<float, NUM_PHASES> phase_durations{};
+    std::vector<float> frame_durations; //Update time of every frame of the last headless run in milliseconds
+    static const char* phase_names[NUM_PHASES];
+    void print_phase_durations(int num_frames, float total_duration) const;
+
+    const char* trace_file = nullptr;
+    HashLog* hash_log = nullptr;
 };
 
 }; // namespace Tmpl8
\ No newline at end of file
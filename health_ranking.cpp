@@ -0,0 +1,35 @@
+#include "precomp.h" // include (only) this in every .cpp file
+
+namespace Tmpl8
+{
+
+void HealthRanking::add(int team, int health)
+{
+    //Grow the histograms to fit the new health value
+    if (health > max_health)
+    {
+        for (int t = 0; t < num_teams; t++) counts[t].resize(health + 1, 0);
+        max_health = health;
+    }
+
+    if (health > 0) counts[team][health]++;
+}
+
+void HealthRanking::change(int team, int old_health, int new_health)
+{
+    if (old_health > 0) counts[team][std::min(old_health, max_health)]--;
+    if (new_health > 0) counts[team][std::min(new_health, max_health)]++;
+}
+
+void HealthRanking::lowest(int team, size_t max_count, std::vector<int>& healths) const
+{
+    healths.clear();
+
+    for (int health = 1; health <= max_health && healths.size() < max_count; health++)
+    {
+        size_t count = std::min((size_t)counts[team][health], max_count - healths.size());
+        healths.insert(healths.end(), count, health);
+    }
+}
+
+} // namespace Tmpl8
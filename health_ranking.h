@@ -0,0 +1,28 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+//Number of living tanks per team per health value
+//Kept up to date as tanks are hit, so the least healthy tanks can be listed without sorting
+//Damage is applied on one thread by TankStore::apply_damage, so the counts need no synchronization
+class HealthRanking
+{
+  public:
+    //Register a new tank, not thread safe
+    void add(int team, int health);
+
+    //A tank of the team went from old_health to new_health, tanks at zero health or below are dead and not counted
+    void change(int team, int old_health, int new_health);
+
+    //Write the health values of the (at most) max_count least healthy living tanks of the team, lowest first
+    void lowest(int team, size_t max_count, std::vector<int>& healths) const;
+
+  private:
+    static constexpr int num_teams = 2;
+
+    int max_health = 0;
+    std::vector<int> counts[num_teams]; //Indexed by health, 1 up to max_health
+};
+
+} // namespace Tmpl8
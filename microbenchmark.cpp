@@ -0,0 +1,356 @@
+// Microbenchmarks of the hot kernels, on synthetic scenes shaped like the real simulation
+// Built as a separate executable from the same sources with TMPL8_MICROBENCHMARK defined (see CMakeLists.txt),
+// which leaves out the main function of template.cpp. Run it from the project directory, it loads sprites from assets/
+
+#include "precomp.h"
+
+#ifdef TMPL8_MICROBENCHMARK
+
+namespace
+{
+
+// Results are folded into this, so the compiler can't drop the measured work
+volatile uint64_t sink = 0;
+
+// Time op(i) for increasing i, in batches that take at least 20 ms
+// The fastest of a few batches counts, that is the least disturbed by other processes
+template <class F>
+double measure(F op)
+{
+    size_t batch_size = 1;
+    uint64_t iteration = 0;
+
+    // Grow the batch until it takes long enough to time reliably
+    while (true)
+    {
+        timer batch_timer;
+        for (size_t i = 0; i < batch_size; i++) op(iteration++);
+        if (batch_timer.elapsed() >= 20.f || batch_size >= (1u << 30)) break;
+        batch_size *= 2;
+    }
+
+    double best_ns = std::numeric_limits<double>::infinity();
+    for (int repetition = 0; repetition < 5; repetition++)
+    {
+        auto start = timer::get();
+        for (size_t i = 0; i < batch_size; i++) op(iteration++);
+        auto end = timer::get();
+
+        double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        best_ns = std::min(best_ns, ns / batch_size);
+    }
+
+    return best_ns;
+}
+
+// Scenes of tanks, both armies have the same size
+enum class Scene
+{
+    CLUSTERED, // Every army in a few dense groups on its own half, like the start of a battle
+    FRONT,     // Both armies pressed together in a narrow band in the middle of the screen
+    RING       // All tanks on one circle, every tank is a hull vertex
+};
+
+void add_tanks(TankStore& tanks, Scene scene, int tanks_per_army)
+{
+    std::mt19937 random(1234);
+    std::normal_distribution<float> cluster_spread(0.f, 40.f);
+    std::normal_distribution<float> front_spread(0.f, 15.f);
+    std::uniform_real_distribution<float> uniform(0.f, 1.f);
+
+    tanks.reserve(tanks_per_army * 2);
+    for (int team = BLUE; team <= RED; team++)
+    {
+        const float side = (team == BLUE) ? 0.f : 1.f;
+        for (int i = 0; i < tanks_per_army; i++)
+        {
+            vec2 position;
+            if (scene == Scene::CLUSTERED)
+            {
+                int cluster = i % 4;
+                vec2 center((0.1f + 0.2f * (cluster % 2) + 0.5f * side) * SCRWIDTH, (0.25f + 0.5f * (cluster / 2)) * SCRHEIGHT);
+                position = center + vec2(cluster_spread(random), cluster_spread(random));
+            }
+            else if (scene == Scene::FRONT)
+            {
+                position = vec2(SCRWIDTH * 0.5f + (side - 0.5f) * 30.f + front_spread(random), uniform(random) * SCRHEIGHT);
+            }
+            else
+            {
+                float angle = 2.f * PI * (2 * i + team) / (2 * tanks_per_army);
+                position = vec2(SCRWIDTH * 0.5f + cosf(angle) * 300.f, SCRHEIGHT * 0.5f + sinf(angle) * 300.f);
+            }
+
+            position.x = clamp(position.x, 0.f, SCRWIDTH - 1.f);
+            position.y = clamp(position.y, 0.f, SCRHEIGHT - 1.f);
+            tanks.add(position, (allignments)team, nullptr, vec2(SCRWIDTH - position.x, position.y), 3.f, 1000, 1.f);
+        }
+    }
+}
+
+// Rockets spread over the screen, flying in random directions
+void add_rockets(RocketPool& rockets, int count)
+{
+    std::mt19937 random(5678);
+    std::uniform_real_distribution<float> uniform(0.f, 1.f);
+
+    rockets.begin_spawning(1);
+    for (int i = 0; i < count; i++)
+    {
+        vec2 position(uniform(random) * SCRWIDTH, uniform(random) * SCRHEIGHT);
+        float angle = uniform(random) * 2.f * PI;
+        rockets.spawn(0, Rocket(position, vec2(cosf(angle), sinf(angle)) * 3.f, 5.f, (i % 2) ? RED : BLUE, nullptr));
+    }
+    rockets.end_spawning();
+}
+
+// Regression check of the grid query behind the forcefield candidates: every tank that isn't strictly inside
+// the polygon has to be returned, also tanks just below 0 that get_cell_index puts in the first row or column
+bool check_tanks_outside_polygon()
+{
+    const std::vector<vec2> polygon = { vec2(-5.f, -5.f), vec2(400.f, -5.f), vec2(400.f, 300.f), vec2(-5.f, 300.f) };
+    const std::vector<vec2> positions = { vec2(-15.f, 100.f), vec2(100.f, -15.f), vec2(-15.f, -15.f), vec2(-1.f, 250.f),
+                                          vec2(200.f, 150.f), vec2(50.f, 50.f), vec2(410.f, 100.f), vec2(100.f, 310.f) };
+
+    TankStore tanks;
+    for (const vec2& position : positions) tanks.add(position, BLUE, nullptr, position, 3.f, 1000, 1.f);
+    Grid grid(SCRWIDTH, SCRHEIGHT, 20.0f);
+    grid.add_tanks(tanks);
+
+    std::vector<uint32_t> found;
+    grid.find_tanks_outside_polygon(tanks, polygon, 0, grid.get_num_rows(), found);
+    found.insert(found.end(), grid.get_outside_tanks().begin(), grid.get_outside_tanks().end());
+
+    bool ok = true;
+    for (uint32_t tank = 0; tank < tanks.size(); tank++)
+    {
+        const vec2& p = tanks.positions[tank];
+        const bool strictly_inside = p.x > -5.f && p.x < 400.f && p.y > -5.f && p.y < 300.f;
+        if (!strictly_inside && std::find(found.begin(), found.end(), tank) == found.end())
+        {
+            printf("check failed: find_tanks_outside_polygon misses the tank at (%.1f, %.1f)\n", p.x, p.y);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+const char* scene_name(Scene scene)
+{
+    switch (scene)
+    {
+    case Scene::CLUSTERED: return "clustered";
+    case Scene::FRONT: return "front";
+    default: return "ring";
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // command line: [--filter TEXT] only runs the benchmarks with TEXT in their name
+    //               [--baseline FILE] prints the change of every benchmark against a saved run
+    //               [--save-baseline FILE] saves this run as a baseline
+    const char* filter = nullptr;
+    const char* baseline_file = nullptr;
+    const char* save_file = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "--filter") == 0) && (i + 1 < argc)) filter = argv[++i];
+        else if ((strcmp(argv[i], "--baseline") == 0) && (i + 1 < argc)) baseline_file = argv[++i];
+        else if ((strcmp(argv[i], "--save-baseline") == 0) && (i + 1 < argc)) save_file = argv[++i];
+        else
+        {
+            printf("unknown argument: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    // Timing wrong results is no use
+    if (!check_tanks_outside_polygon()) return 1;
+
+    // Baseline files hold one "ns_per_op name" line per benchmark
+    std::vector<std::pair<std::string, double>> baseline;
+    if (baseline_file)
+    {
+        std::ifstream file(baseline_file);
+        if (!file.is_open())
+        {
+            printf("could not open baseline file: %s\n", baseline_file);
+            return 1;
+        }
+
+        double ns;
+        std::string name;
+        while (file >> ns && std::getline(file >> std::ws, name)) baseline.emplace_back(name, ns);
+    }
+
+    std::vector<std::pair<std::string, double>> results;
+    auto run = [&](const std::string& name, auto op) {
+        if (filter && name.find(filter) == std::string::npos) return;
+
+        double ns = measure(op);
+        results.emplace_back(name, ns);
+
+        auto previous = std::find_if(baseline.begin(), baseline.end(), [&](const auto& entry) { return entry.first == name; });
+        if (previous != baseline.end())
+            printf("%-64s %12.1f ns/op %+8.1f%%\n", name.c_str(), ns, 100.0 * (ns / previous->second - 1.0));
+        else
+            printf("%-64s %12.1f ns/op\n", name.c_str(), ns);
+        fflush(stdout);
+    };
+
+    // Single threaded, so the numbers are about the kernels and not about scheduling
+    ThreadPool inline_pool(0);
+
+    // Grid queries and the forcefield on every tank scene
+    for (Scene scene : { Scene::CLUSTERED, Scene::FRONT, Scene::RING })
+    {
+        const int tanks_per_army = (scene == Scene::RING) ? 512 : 2048;
+        const std::string suffix = std::string(", ") + scene_name(scene) + " " + std::to_string(tanks_per_army * 2);
+
+        TankStore tanks;
+        add_tanks(tanks, scene, tanks_per_army);
+        Grid grid(SCRWIDTH, SCRHEIGHT, 20.0f);
+        grid.add_tanks(tanks);
+
+        run("grid add_tanks" + suffix, [&](uint64_t) { grid.add_tanks(tanks); });
+        run("grid find_closest_enemy" + suffix, [&](uint64_t i) { sink += grid.find_closest_enemy(tanks, (uint32_t)(i % tanks.size())); });
+        run("grid calculate_tank_collisions" + suffix, [&](uint64_t) {
+            grid.calculate_tank_collisions(tanks);
+            std::fill(tanks.forces.begin(), tanks.forces.end(), vec2(0.f));
+        });
+        run("grid find_rocket_collision" + suffix, [&](uint64_t i) {
+            const vec2& position = tanks.positions[i % tanks.size()];
+            sink += grid.find_rocket_collision(tanks, position + vec2(4.f, 4.f), 5.f, (i % 2) ? RED : BLUE);
+        });
+
+        ForcefieldHull hull;
+        run("forcefield hull update" + suffix, [&](uint64_t) { hull.update(tanks, grid, inline_pool); });
+
+        RocketPool rockets(4096, vec2(SCRWIDTH, SCRHEIGHT));
+        add_rockets(rockets, 4096);
+        std::vector<uint32_t> hits;
+        run("forcefield find_rocket_collisions 4096" + suffix + " (" + std::to_string(hull.size()) + " edges)", [&](uint64_t) {
+            hull.find_rocket_collisions(rockets, inline_pool, hits);
+            sink += hits.size();
+        });
+    }
+
+    // Scalar circle segment test, the reference for the forcefield kernel
+    {
+        std::mt19937 random(42);
+        std::uniform_real_distribution<float> uniform(0.f, 200.f);
+        std::vector<vec2> points(1024 * 3);
+        for (vec2& point : points) point = vec2(uniform(random), uniform(random));
+
+        run("circle_segment_intersect", [&](uint64_t i) {
+            size_t j = (i % 1024) * 3;
+            sink += circle_segment_intersect(points[j], points[j + 1], points[j + 2], 5.f);
+        });
+    }
+
+    // Routing on the real map
+    {
+        Terrain terrain;
+        TankStore tanks;
+        for (int i = 0; i < 16; i++) tanks.add(vec2(50.f, 40.f + i * 40.f), BLUE, nullptr, vec2(1200.f, 40.f + i * 40.f), 3.f, 1000, 1.f);
+
+        std::vector<vec2> route;
+        run("terrain get_route across the map", [&](uint64_t i) {
+            Tank tank = tanks[i % tanks.size()];
+            terrain.get_route(tank, tank.target(), route);
+            sink += route.size();
+        });
+
+        const int field = terrain.get_flow_field(vec2(1200.f, 360.f));
+        run("terrain next_waypoint", [&](uint64_t i) {
+            vec2 waypoint = terrain.next_waypoint(field, tanks.positions[i % tanks.size()]);
+            sink += (uint64_t)waypoint.x;
+        });
+    }
+
+    // Ranking and sorting of tank health
+    {
+        std::mt19937 random(7);
+        std::uniform_int_distribution<int> health(1, 1000);
+
+        HealthRanking ranking;
+        std::vector<uint32_t> keys(4096), values(4096), unsorted_keys(4096);
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            unsorted_keys[i] = health(random);
+            ranking.add((int)(i % 2), (int)unsorted_keys[i]);
+        }
+
+        std::vector<int> lowest;
+        run("health ranking lowest 720 of 2048", [&](uint64_t i) {
+            ranking.lowest((int)(i % 2), 720, lowest);
+            sink += lowest.size();
+        });
+
+        RadixSort radix_sort;
+        run("radix sort 4096 health keys", [&](uint64_t) {
+            keys = unsorted_keys;
+            for (uint32_t v = 0; v < values.size(); v++) values[v] = v;
+            radix_sort.sort(keys, values, inline_pool, RadixSort::key_bits_for(1000));
+            sink += values[0];
+        });
+    }
+
+    // Drawing
+    {
+        Surface screen(SCRWIDTH, SCRHEIGHT);
+        screen.clear(0);
+        run("surface clear " + std::to_string(SCRWIDTH) + "x" + std::to_string(SCRHEIGHT), [&](uint64_t i) { screen.clear((Pixel)i); });
+        run("surface bar 720 health bars", [&](uint64_t i) {
+            for (int y = 0; y < SCRHEIGHT; y++) screen.bar(0, y, HEALTHBAR_OFFSET - 1 - (int)((i + y) % 16), y, (Pixel)i);
+        });
+
+        std::mt19937 random(99);
+        std::uniform_int_distribution<int> x(0, SCRWIDTH - 64), y(0, SCRHEIGHT - 64);
+        std::vector<std::pair<int, int>> positions(1024);
+        for (auto& position : positions) position = { x(random), y(random) };
+
+        Surface tank_image("assets/Tank_Proj2.png");
+        Sprite tank(&tank_image, 12);
+        run("sprite draw tank", [&](uint64_t i) {
+            tank.draw(&screen, positions[i % 1024].first, positions[i % 1024].second, (unsigned int)(i % 12));
+        });
+
+        Surface smoke_image("assets/Smoke.png");
+        Sprite smoke(&smoke_image, 4);
+        run("sprite draw smoke", [&](uint64_t i) {
+            smoke.draw(&screen, positions[i % 1024].first, positions[i % 1024].second, (unsigned int)(i % 4));
+        });
+
+        std::vector<Pixel> colors(4096);
+        for (Pixel& color : colors) color = (Pixel)random();
+        run("add_blend 4096 pixels", [&](uint64_t i) {
+            Pixel* buffer = screen.get_buffer() + (i % 64) * 4096;
+            for (size_t p = 0; p < colors.size(); p++) buffer[p] = add_blend(buffer[p], colors[p]);
+        });
+        run("add_blend_span 4096 pixels", [&](uint64_t i) {
+            Pixel* buffer = screen.get_buffer() + (i % 64) * 4096;
+            add_blend_span(buffer, colors.data(), (int)colors.size());
+        });
+    }
+
+    if (save_file)
+    {
+        std::ofstream file(save_file);
+        if (!file.is_open())
+        {
+            printf("could not open baseline file: %s\n", save_file);
+            return 1;
+        }
+
+        for (const auto& result : results) file << result.second << " " << result.first << "\n";
+        printf("saved %zu results to %s\n", results.size(), save_file);
+    }
+
+    return 0;
+}
+
+#endif // TMPL8_MICROBENCHMARK
@@ -8,8 +8,8 @@ class Particle_beam
     Particle_beam();
     Particle_beam(vec2 min, vec2 max, Sprite* particle_beam_sprite, int damage);
 
-    void tick(vector<Tank>& tanks);
-    void draw(Surface* screen);
+    void tick(TankStore& tanks);
+    void draw(TileRenderer& renderer);
 
     vec2 min_position;
     vec2 max_position;
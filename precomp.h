@@ -65,6 +65,7 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 // Header for AVX, and every technology before it.
 // If your CPU does not support this, include the appropriate header instead.
@@ -82,16 +83,23 @@ using namespace std;
 
 using namespace Tmpl8;
 
+#include "profiler.h"
 #include "thread_pool.h"
+#include "event_buffer.h"
+#include "state_hash.h"
+#include "radix_sort.h"
+#include "tile_renderer.h"
 
+#include "health_ranking.h"
+#include "tank_store.h"
 #include "tank.h"
 #include "terrain.h"
 #include "rocket.h"
-#include "smoke.h"
-#include "explosion.h"
+#include "rocket_pool.h"
+#include "effects.h"
 #include "particle_beam.h"
-#include "merge_sort.h"
 #include "Grid.h"
+#include "forcefield_hull.h"
 
 #include "game.h"
 
@@ -0,0 +1,68 @@
+#include "precomp.h" // include (only) this in every .cpp file
+
+namespace Tmpl8
+{
+
+Profiler* Profiler::instance = nullptr;
+
+Profiler::Profiler(size_t capacity) : spans(std::max<size_t>(capacity, 1)), epoch(timer::get())
+{
+}
+
+void Profiler::enable(size_t capacity)
+{
+    if (!instance) instance = new Profiler(capacity);
+}
+
+uint32_t Profiler::thread_index()
+{
+    static std::atomic<uint32_t> thread_count{ 0 };
+    thread_local uint32_t index = thread_count++;
+    return index;
+}
+
+// -----------------------------------------------------------
+// Store a span in the ring buffer, overwriting the oldest one when full
+// Every thread claims its own slot, so no locking is needed
+// -----------------------------------------------------------
+void Profiler::record(const char* name, timer::TimePoint start, timer::TimePoint end)
+{
+    ProfileSpan& span = spans[next_span++ % spans.size()];
+    span.name = name;
+    span.thread_id = thread_index();
+    span.frame = frame;
+    span.start_us = std::chrono::duration_cast<timer::MicroSeconds>(start - epoch).count();
+    span.end_us = std::chrono::duration_cast<timer::MicroSeconds>(end - epoch).count();
+}
+
+// -----------------------------------------------------------
+// Write all recorded spans as complete ("X") events in the Chrome trace event format
+// Only call this when no other thread is recording
+// -----------------------------------------------------------
+bool Profiler::write_chrome_trace(const char* file_path) const
+{
+    std::ofstream trace_file(file_path);
+    if (!trace_file.is_open())
+    {
+        std::cout << "Could not open trace file: " << file_path << std::endl;
+        return false;
+    }
+
+    const uint64 num_spans = std::min<uint64>(next_span, spans.size());
+    const uint64 first_span = next_span - num_spans;
+
+    trace_file << "{\"traceEvents\":[\n";
+    for (uint64 i = 0; i < num_spans; i++)
+    {
+        const ProfileSpan& span = spans[(first_span + i) % spans.size()];
+        trace_file << "{\"name\":\"" << span.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.thread_id
+                   << ",\"ts\":" << span.start_us << ",\"dur\":" << (span.end_us - span.start_us)
+                   << ",\"args\":{\"frame\":" << span.frame << "}}" << ((i + 1 < num_spans) ? ",\n" : "\n");
+    }
+    trace_file << "],\"displayTimeUnit\":\"ms\"}\n";
+
+    std::cout << "Wrote " << num_spans << " spans to " << file_path << std::endl;
+    return true;
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,65 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// A single timed section on one thread
+struct ProfileSpan
+{
+    const char* name;
+    uint32_t thread_id;
+    uint32_t frame;
+    int64 start_us;
+    int64 end_us;
+};
+
+// Records timed spans of all threads into a fixed size ring buffer
+// Once the buffer is full the oldest spans are overwritten, so a long run keeps its last frames
+// The spans can be written as a Chrome trace (load it in chrome://tracing or ui.perfetto.dev)
+class Profiler
+{
+  public:
+    Profiler(size_t capacity);
+
+    // Create the global profiler, spans are only recorded after this is called
+    static void enable(size_t capacity = (1 << 20));
+    static Profiler* get() { return instance; }
+
+    // Spans recorded after this call are tagged with the given frame index
+    void begin_frame(uint32_t frame_index) { frame = frame_index; }
+    void record(const char* name, timer::TimePoint start, timer::TimePoint end);
+
+    bool write_chrome_trace(const char* file_path) const;
+
+  private:
+    static Profiler* instance;
+
+    // Small sequential id for the calling thread (main thread is usually 0)
+    static uint32_t thread_index();
+
+    std::vector<ProfileSpan> spans;
+    std::atomic<uint64> next_span{ 0 };
+    std::atomic<uint32_t> frame{ 0 };
+    timer::TimePoint epoch;
+};
+
+// Times the enclosing scope and records it in the global profiler (if enabled)
+// The duration in milliseconds is also added to the accumulator when one is given
+class ScopedTimer
+{
+  public:
+    ScopedTimer(const char* name, float* accumulator = nullptr) : name(name), accumulator(accumulator), start(timer::get()) {}
+    ~ScopedTimer()
+    {
+        timer::TimePoint end = timer::get();
+        if (accumulator) *accumulator += std::chrono::duration<float, std::milli>(end - start).count();
+        if (Profiler* profiler = Profiler::get()) profiler->record(name, start, end);
+    }
+
+  private:
+    const char* name;
+    float* accumulator;
+    timer::TimePoint start;
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,77 @@
+#include "precomp.h" // include (only) this in every .cpp file
+
+namespace Tmpl8
+{
+
+void RadixSort::sort(std::vector<uint32_t>& keys, std::vector<uint32_t>& values, ThreadPool& thread_pool, int key_bits)
+{
+    const size_t count = keys.size();
+    if (count <= 1) return;
+
+    key_scratch.resize(count);
+    value_scratch.resize(count);
+
+    //One block per thread (and the calling thread), unless that makes the blocks too small
+    const size_t max_blocks = thread_pool.num_threads() + 1;
+    const size_t num_blocks = std::max<size_t>(1, std::min(max_blocks, count / min_block_size));
+    const size_t block_size = (count + num_blocks - 1) / num_blocks;
+    block_offsets.resize(num_blocks * num_buckets);
+
+    for (int shift = 0; shift < key_bits; shift += digit_bits)
+    {
+        //Count the digits of every block
+        thread_pool.parallel_for(0, num_blocks, 1, [&](size_t begin, size_t end) {
+            for (size_t block = begin; block < end; block++)
+            {
+                uint32_t* histogram = &block_offsets[block * num_buckets];
+                std::fill(histogram, histogram + num_buckets, 0);
+
+                const size_t block_end = std::min(count, (block + 1) * block_size);
+                for (size_t i = block * block_size; i < block_end; i++)
+                {
+                    histogram[(keys[i] >> shift) & (num_buckets - 1)]++;
+                }
+            }
+        });
+
+        //Turn the counts into scatter positions: bucket by bucket, and within a bucket block by block,
+        //so pairs with the same digit keep their order
+        //A pass where all keys have the same digit wouldn't move anything and is skipped
+        uint32_t offset = 0;
+        bool single_bucket = false;
+        for (size_t bucket = 0; bucket < num_buckets && !single_bucket; bucket++)
+        {
+            const uint32_t bucket_start = offset;
+            for (size_t block = 0; block < num_blocks; block++)
+            {
+                uint32_t& entry = block_offsets[block * num_buckets + bucket];
+                const uint32_t block_count = entry;
+                entry = offset;
+                offset += block_count;
+            }
+            single_bucket = (offset - bucket_start == count);
+        }
+        if (single_bucket) continue;
+
+        //Every block moves its pairs to their positions
+        thread_pool.parallel_for(0, num_blocks, 1, [&](size_t begin, size_t end) {
+            for (size_t block = begin; block < end; block++)
+            {
+                uint32_t* positions = &block_offsets[block * num_buckets];
+
+                const size_t block_end = std::min(count, (block + 1) * block_size);
+                for (size_t i = block * block_size; i < block_end; i++)
+                {
+                    const uint32_t position = positions[(keys[i] >> shift) & (num_buckets - 1)]++;
+                    key_scratch[position] = keys[i];
+                    value_scratch[position] = values[i];
+                }
+            }
+        });
+
+        keys.swap(key_scratch);
+        values.swap(value_scratch);
+    }
+}
+
+} // namespace Tmpl8
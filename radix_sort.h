@@ -0,0 +1,44 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+//Stable LSD radix sort of (key, value) pairs, typically a sort key and a tank index
+//Every pass handles 8 bits of the key: the input is split in blocks, every block builds its own
+//histogram on the thread pool, and the blocks scatter their pairs in parallel to offsets that
+//keep equal keys in their original order. The scratch buffers are kept, so sorting the same
+//number of pairs again doesn't allocate.
+class RadixSort
+{
+  public:
+    //Sort the pairs (keys[i], values[i]) on key, only the lowest key_bits bits of the keys are looked at
+    //On return both vectors hold the sorted pairs, values is the stable permutation of the input
+    void sort(std::vector<uint32_t>& keys, std::vector<uint32_t>& values, ThreadPool& thread_pool, int key_bits = 32);
+
+    //Unsigned key with the same order as the given float, for sorting on coordinates
+    static uint32_t float_key(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    }
+
+    //Number of bits needed for keys up to max_key
+    static int key_bits_for(uint32_t max_key)
+    {
+        int bits = 0;
+        while (bits < 32 && (max_key >> bits) != 0) bits++;
+        return bits;
+    }
+
+  private:
+    static constexpr int digit_bits = 8;
+    static constexpr size_t num_buckets = 1 << digit_bits;
+    static constexpr size_t min_block_size = 4096; //Smaller blocks cost more in histogram clearing than they save
+
+    std::vector<uint32_t> key_scratch;
+    std::vector<uint32_t> value_scratch;
+    std::vector<uint32_t> block_offsets; //num_buckets entries per block: counts, then scatter positions
+};
+
+} // namespace Tmpl8
@@ -10,7 +10,7 @@ class Rocket
     ~Rocket();
 
     void tick();
-    void draw(Surface* screen);
+    void draw(TileRenderer& renderer);
 
     bool intersects(vec2 position_other, float radius_other) const;
 
@@ -0,0 +1,41 @@
+#include "precomp.h" // include (only) this in every .cpp file
+
+namespace Tmpl8
+{
+
+RocketPool::RocketPool(size_t capacity, vec2 play_area) : play_area(play_area)
+{
+    rockets.reserve(capacity);
+}
+
+void RocketPool::end_spawning()
+{
+    spawned.apply([this](const Rocket& rocket) { rockets.push_back(rocket); });
+}
+
+void RocketPool::remove_inactive()
+{
+    //Swap remove: the last rocket takes the place of the removed one, which is checked again next
+    size_t i = 0;
+    while (i < rockets.size())
+    {
+        if (rockets[i].active && in_play_area(rockets[i]))
+        {
+            i++;
+            continue;
+        }
+
+        rockets[i] = rockets.back();
+        rockets.pop_back();
+    }
+}
+
+//Rockets fly in a straight line, once they are out of the play area they can't hit anything anymore
+bool RocketPool::in_play_area(const Rocket& rocket) const
+{
+    const vec2& position = rocket.position;
+    const float radius = rocket.collision_radius;
+    return position.x >= -radius && position.y >= -radius && position.x <= play_area.x + radius && position.y <= play_area.y + radius;
+}
+
+} // namespace Tmpl8
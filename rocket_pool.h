@@ -0,0 +1,42 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+//Storage for all rockets in flight
+//The rockets live in one array that is allocated up front. Dead rockets are removed by moving the
+//last rocket into their slot, so the order of the rockets is not preserved.
+//Rockets are spawned from parallel tasks into an EventBuffer and appended in task order afterwards.
+class RocketPool
+{
+  public:
+    //Preallocate room for the given number of rockets, the pool only grows if more are alive at once
+    //Rockets that leave the play_area (plus their collision radius) are culled automatically
+    RocketPool(size_t capacity, vec2 play_area);
+
+    //Prepare one empty spawn buffer per task
+    void begin_spawning(size_t num_tasks) { spawned.begin(num_tasks); }
+    //Spawn a rocket from a task, every task only touches its own buffer
+    void spawn(size_t task, const Rocket& rocket) { spawned.push(task, rocket); }
+    //Add the spawned rockets to the pool, in task order
+    void end_spawning();
+
+    //Remove rockets that are inactive or outside the play area
+    void remove_inactive();
+
+    size_t size() const { return rockets.size(); }
+    Rocket& operator[](size_t index) { return rockets[index]; }
+    const Rocket& operator[](size_t index) const { return rockets[index]; }
+
+    std::vector<Rocket>::iterator begin() { return rockets.begin(); }
+    std::vector<Rocket>::iterator end() { return rockets.end(); }
+
+  private:
+    bool in_play_area(const Rocket& rocket) const;
+
+    std::vector<Rocket> rockets;
+    EventBuffer<Rocket> spawned;
+    vec2 play_area;
+};
+
+} // namespace Tmpl8
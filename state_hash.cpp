@@ -0,0 +1,97 @@
+#include "precomp.h" // include (only) this in every .cpp file
+
+namespace Tmpl8
+{
+
+void StateHash::add_bytes(const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+}
+
+// -----------------------------------------------------------
+// Hashes are stored as one "frame hash" line per frame, the hash in hexadecimal
+// -----------------------------------------------------------
+bool HashLog::open(const char* path, Mode log_mode)
+{
+    mode = log_mode;
+    file_path = path;
+    hashes.clear();
+
+    if (mode == RECORD) return true;
+
+    std::ifstream hash_file(file_path);
+    if (!hash_file.is_open())
+    {
+        std::cout << "Could not open hash file: " << file_path << std::endl;
+        return false;
+    }
+
+    uint64_t frame_index;
+    std::string hash;
+    while (hash_file >> frame_index >> hash)
+    {
+        if (frame_index >= hashes.size()) hashes.resize(frame_index + 1, 0);
+        hashes[frame_index] = std::stoull(hash, nullptr, 16);
+    }
+
+    return true;
+}
+
+void HashLog::frame(uint64_t frame_index, uint64_t hash)
+{
+    num_frames = std::max(num_frames, frame_index + 1);
+
+    if (mode == RECORD)
+    {
+        if (frame_index >= hashes.size()) hashes.resize(frame_index + 1, 0);
+        hashes[frame_index] = hash;
+        return;
+    }
+
+    if (frame_index < hashes.size() && hashes[frame_index] == hash) return;
+
+    if (num_mismatches++ == 0)
+    {
+        first_mismatch = frame_index;
+        std::cout << "State diverged at frame " << frame_index << std::endl;
+    }
+}
+
+bool HashLog::finish()
+{
+    if (mode == RECORD)
+    {
+        std::ofstream hash_file(file_path);
+        if (!hash_file.is_open())
+        {
+            std::cout << "Could not open hash file: " << file_path << std::endl;
+            return false;
+        }
+
+        char line[64];
+        for (uint64_t i = 0; i < num_frames; i++)
+        {
+            snprintf(line, sizeof(line), "%" PRIu64 " %016" PRIx64 "\n", i, hashes[i]);
+            hash_file << line;
+        }
+
+        std::cout << "Recorded " << num_frames << " state hashes to " << file_path << std::endl;
+        return true;
+    }
+
+    if (num_mismatches == 0)
+    {
+        std::cout << "State hashes of " << num_frames << " frames match " << file_path << std::endl;
+        return true;
+    }
+
+    std::cout << num_mismatches << " of " << num_frames << " frames differ from " << file_path
+              << ", first at frame " << first_mismatch << std::endl;
+    return false;
+}
+
+} // namespace Tmpl8
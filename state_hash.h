@@ -0,0 +1,59 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// 64 bit FNV-1a hash over simulation state
+// Values are hashed field by field, so padding bytes and pointers never end up in the hash
+class StateHash
+{
+  public:
+    void add_bytes(const void* data, size_t size);
+
+    template <class T>
+    void add(const T& value) { add_bytes(&value, sizeof(T)); }
+
+    template <class T>
+    void add(const std::vector<T>& values)
+    {
+        add(values.size());
+        add_bytes(values.data(), values.size() * sizeof(T));
+    }
+
+    uint64_t value() const { return hash; }
+
+  private:
+    uint64_t hash = 14695981039346656037ull;
+};
+
+// Writes the state hash of every frame to a text file, or checks a run against such a file
+// Two runs of the same build and frame count should produce the same hashes, whatever the number of threads
+class HashLog
+{
+  public:
+    enum Mode
+    {
+        RECORD,
+        VERIFY
+    };
+
+    // Returns false if the file can't be opened
+    bool open(const char* file_path, Mode mode);
+
+    // Record or check the hash of the given frame, the first difference is reported
+    void frame(uint64_t frame_index, uint64_t hash);
+
+    // Write the recorded hashes or report the verification result, returns false if the run diverged
+    bool finish();
+
+  private:
+    Mode mode = RECORD;
+    std::string file_path;
+
+    std::vector<uint64_t> hashes; // Hash per frame, recorded or loaded from the file
+    uint64_t num_frames = 0;
+    uint64_t first_mismatch = UINT64_MAX;
+    uint64_t num_mismatches = 0;
+};
+
+} // namespace Tmpl8
@@ -78,8 +78,7 @@ Surface::~Surface()
 
 void Surface::clear(Pixel a_Color)
 {
-    int s = m_Width * m_Height;
-    for (int i = 0; i < s; i++) m_Buffer[i] = a_Color;
+    stream_fill(m_Buffer, a_Color, (size_t)m_Width * m_Height);
 }
 
 void Surface::centre(const char* a_String, int y1, Pixel color)
@@ -141,9 +140,14 @@ void Surface::resize(Surface* a_Orig)
 #define OUTCODE(x, y) (((x) < xmin) ? 1 : (((x) > xmax) ? 2 : 0)) + (((y) < ymin) ? 4 : (((y) > ymax) ? 8 : 0))
 
 void Surface::line(float x1, float y1, float x2, float y2, Pixel c)
+{
+    line(x1, y1, x2, y2, c, 0, 0, m_Width, m_Height);
+}
+
+void Surface::line(float x1, float y1, float x2, float y2, Pixel c, int a_OriginX, int a_OriginY, int a_Width, int a_Height)
 {
     // clip (Cohen-Sutherland, https://en.wikipedia.org/wiki/Cohen%E2%80%93Sutherland_algorithm)
-    const float xmin = 0, ymin = 0, xmax = (float)m_Width - 1, ymax = (float)m_Height - 1;
+    const float xmin = 0, ymin = 0, xmax = (float)a_Width - 1, ymax = (float)a_Height - 1;
     int c0 = OUTCODE(x1, y1), c1 = OUTCODE(x2, y2);
     bool accept = false;
     while (1)
@@ -183,7 +187,8 @@ void Surface::line(float x1, float y1, float x2, float y2, Pixel c)
     float dy = h / (float)l;
     for (int i = 0; i <= il; i++)
     {
-        *(m_Buffer + (int)x1 + (int)y1 * m_Pitch) = c;
+        const int x = (int)x1 - a_OriginX, y = (int)y1 - a_OriginY;
+        if ((x >= 0) && (y >= 0) && (x < m_Width) && (y < m_Height)) m_Buffer[x + y * m_Pitch] = c;
         x1 += dx, y1 += dy;
     }
 }
@@ -212,11 +217,20 @@ void Surface::bar(int x1, int y1, int x2, int y2, Pixel c)
     Pixel* a = x1 + y1 * m_Pitch + m_Buffer;
     for (int y = y1; y <= y2; y++)
     {
-        for (int x = 0; x <= (x2 - x1); x++) a[x] = c;
+        if (x2 >= x1) fill_span(a, c, x2 - x1 + 1);
         a += m_Pitch;
     }
 }
 
+void Surface::fill_rect(int x1, int y1, int x2, int y2, Pixel c)
+{
+    x1 = std::max(x1, 0), x2 = std::min(x2, m_Width);
+    y1 = std::max(y1, 0), y2 = std::min(y2, m_Height);
+    if ((x2 <= x1) || (y2 <= y1)) return;
+
+    for (int y = y1; y < y2; y++) fill_span(m_Buffer + y * m_Pitch + x1, c, x2 - x1);
+}
+
 void Surface::copy_to(Surface* a_Dst, int a_X, int a_Y)
 {
     Pixel* dst = a_Dst->get_buffer();
@@ -246,6 +260,61 @@ void Surface::copy_to(Surface* a_Dst, int a_X, int a_Y)
     }
 }
 
+void add_blend_span(Pixel* dst, const Pixel* src, int count)
+{
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i rgb8 = _mm256_set1_epi32(0xffffff);
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i sum = _mm256_adds_epu8(_mm256_loadu_si256((const __m256i*)(dst + i)), _mm256_loadu_si256((const __m256i*)(src + i)));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_and_si256(sum, rgb8));
+    }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128i rgb4 = _mm_set1_epi32(0xffffff);
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i sum = _mm_adds_epu8(_mm_loadu_si128((const __m128i*)(dst + i)), _mm_loadu_si128((const __m128i*)(src + i)));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_and_si128(sum, rgb4));
+    }
+#endif
+    for (; i < count; i++) dst[i] = add_blend(dst[i], src[i]);
+}
+
+void fill_span(Pixel* dst, Pixel color, size_t count)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i color8 = _mm256_set1_epi32((int)color);
+    for (; i + 8 <= count; i += 8) _mm256_storeu_si256((__m256i*)(dst + i), color8);
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128i color4 = _mm_set1_epi32((int)color);
+    for (; i + 4 <= count; i += 4) _mm_storeu_si128((__m128i*)(dst + i), color4);
+#endif
+    for (; i < count; i++) dst[i] = color;
+}
+
+void stream_fill(Pixel* dst, Pixel color, size_t count)
+{
+#if defined(__SSE2__) || defined(_M_X64)
+    //Streaming stores need 16 byte aligned addresses, fill up to the first one normally
+    const size_t head = std::min(count, ((16 - ((uintptr_t)dst & 15)) & 15) / sizeof(Pixel));
+    fill_span(dst, color, head);
+
+    size_t i = head;
+    const __m128i color4 = _mm_set1_epi32((int)color);
+    for (; i + 4 <= count; i += 4) _mm_stream_si128((__m128i*)(dst + i), color4);
+    //Make the streamed stores visible before anything else touches the buffer
+    _mm_sfence();
+
+    fill_span(dst + i, color, count - i);
+#else
+    fill_span(dst, color, count);
+#endif
+}
+
 void Surface::blend_copy_to(Surface* a_Dst, int a_X, int a_Y)
 {
     Pixel* dst = a_Dst->get_buffer();
@@ -267,7 +336,7 @@ void Surface::blend_copy_to(Surface* a_Dst, int a_X, int a_Y)
             dst += a_X + dstpitch * a_Y;
             for (int y = 0; y < srcheight; y++)
             {
-                for (int x = 0; x < srcwidth; x++) dst[x] = add_blend(dst[x], src[x]);
+                add_blend_span(dst, src, srcwidth);
                 dst += dstpitch;
                 src += srcpitch;
             }
@@ -358,9 +427,7 @@ Sprite::Sprite(Surface* a_Surface, unsigned int a_NumFrames) : m_Width(a_Surface
                                                                m_Height(a_Surface->get_height()),
                                                                m_Pitch(a_Surface->get_width()),
                                                                m_NumFrames(a_NumFrames),
-                                                               m_CurrentFrame(0),
                                                                m_Flags(0),
-                                                               m_Start(new unsigned int*[a_NumFrames]),
                                                                m_Surface(a_Surface)
 {
     initialize_start_data();
@@ -368,77 +435,59 @@ Sprite::Sprite(Surface* a_Surface, unsigned int a_NumFrames) : m_Width(a_Surface
 
 Sprite::~Sprite()
 {
-    for (unsigned int i = 0; i < m_NumFrames; i++) delete m_Start[i];
-    delete m_Start;
 }
 
-void Sprite::draw(Surface* a_Target, int a_X, int a_Y)
+void Sprite::draw(Surface* a_Target, int a_X, int a_Y, unsigned int a_Frame) const
 {
-    //If out of screen skip
-    if ((a_X < -m_Width) || (a_X > (a_Target->get_width() + m_Width))) return;
-    if ((a_Y < -m_Height) || (a_Y > (a_Target->get_height() + m_Height))) return;
+    draw_clipped(a_Target, a_X, a_Y, a_Frame, 0, 0, a_Target->get_width(), a_Target->get_height());
+}
 
-    //Get start and end points
-    int x1 = a_X, x2 = a_X + m_Width;
-    int y1 = a_Y, y2 = a_Y + m_Height;
+void Sprite::draw_clipped(Surface* a_Target, int a_X, int a_Y, unsigned int a_Frame, int a_ClipX1, int a_ClipY1, int a_ClipX2, int a_ClipY2) const
+{
+    //Get start and end points, within the clip rectangle
+    const int x1 = std::max(a_X, a_ClipX1), x2 = std::min(a_X + m_Width, a_ClipX2);
+    const int y1 = std::max(a_Y, a_ClipY1), y2 = std::min(a_Y + m_Height, a_ClipY2);
+    if ((x2 <= x1) || (y2 <= y1)) return;
 
-    //Image start
-    Pixel* src = get_buffer() + m_CurrentFrame * m_Width;
-    //Set start x to within screen
-    if (x1 < 0)
-    {
-        src += -x1;
-        x1 = 0;
-    }
-    //Set end x to within screen
-    if (x2 > a_Target->get_width()) x2 = a_Target->get_width();
-    if (y1 < 0)
-    {
-        src += -y1 * m_Pitch;
-        y1 = 0;
-    }
-    if (y2 > a_Target->get_height()) y2 = a_Target->get_height();
+    //Image start, at the first visible row and column
+    const Pixel* src = m_Surface->get_buffer() + a_Frame * m_Width + (y1 - a_Y) * m_Pitch + (x1 - a_X);
     Pixel* dest = a_Target->get_buffer();
-    int xs;
     const int dpitch = a_Target->get_pitch();
-    if ((x2 > x1) && (y2 > y1))
+
+    unsigned int addr = y1 * dpitch + x1;
+    const int height = y2 - y1;
+    //Visible columns of the sprite
+    const int visible_begin = x1 - a_X, visible_end = x2 - a_X;
+    const unsigned int* row_spans = &m_RowSpans[a_Frame * m_Height];
+    for (int y = 0; y < height; y++)
     {
-        unsigned int addr = y1 * dpitch + x1;
-        const int width = x2 - x1;
-        const int height = y2 - y1;
-        for (int y = 0; y < height; y++)
+        //Only the opaque runs of the row are touched, clipped to the visible columns
+        const int line = y + (y1 - a_Y);
+        for (unsigned int span = row_spans[line]; span < row_spans[line + 1]; span++)
         {
-            const int line = y + (y1 - a_Y);
-            const int lsx = m_Start[m_CurrentFrame][line] + a_X;
-            if (m_Flags & FLARE)
-            {
-                xs = (lsx > x1) ? lsx - x1 : 0;
-                for (int x = xs; x < width; x++)
-                {
-                    const Pixel c1 = *(src + x);
-                    if (c1 & 0xffffff)
-                    {
-                        const Pixel c2 = *(dest + addr + x);
-                        *(dest + addr + x) = add_blend(c1, c2);
-                    }
-                }
-            }
-            else
-            {
-                xs = (lsx > x1) ? lsx - x1 : 0;
-                for (int x = xs; x < width; x++)
-                {
-                    const Pixel c1 = *(src + x);
-                    if (c1 & 0xffffff) *(dest + addr + x) = c1;
-                }
-            }
-            addr += dpitch;
-            src += m_Pitch;
+            const int begin = std::max<int>(m_Spans[span].x, visible_begin);
+            const int end = std::min<int>(m_Spans[span].x + m_Spans[span].length, visible_end);
+            if (begin >= end) continue;
+
+            const int x = begin - visible_begin;
+            if (m_Flags & FLARE) add_blend_span(dest + addr + x, src + x, end - begin);
+            else memcpy(dest + addr + x, src + x, (end - begin) * sizeof(Pixel));
         }
+        addr += dpitch;
+        src += m_Pitch;
+    }
+}
+
+void Sprite::draw_batch(Surface* a_Target, const SpriteDraw* a_Draws, const uint32_t* a_Order, size_t a_Count, int a_OriginX, int a_OriginY) const
+{
+    for (size_t i = 0; i < a_Count; i++)
+    {
+        const SpriteDraw& draw = a_Draws[a_Order[i]];
+        draw_clipped(a_Target, draw.x - a_OriginX, draw.y - a_OriginY, draw.frame, 0, 0, a_Target->get_width(), a_Target->get_height());
     }
 }
 
-void Sprite::draw_scaled(int a_X, int a_Y, int a_Width, int a_Height, Surface* a_Target)
+void Sprite::draw_scaled(int a_X, int a_Y, int a_Width, int a_Height, Surface* a_Target, unsigned int a_Frame) const
 {
     if ((a_Width == 0) || (a_Height == 0)) return;
     if ((a_X < -a_Width) || (a_X > (a_Target->get_width() + a_Width))) return;
@@ -472,9 +521,9 @@ void Sprite::draw_scaled(int a_X, int a_Y, int a_Width, int a_Height, Surface* a
     {
         for (int y = y_start; y < y_end; y++)
         {
-            int u = (int)((float)x * ((float)m_Width / (float)a_Width)) + m_CurrentFrame * m_Width;
+            int u = (int)((float)x * ((float)m_Width / (float)a_Width)) + a_Frame * m_Width;
             int v = (int)((float)y * ((float)m_Height / (float)a_Height));
-            Pixel color = get_buffer()[u + v * m_Pitch];
+            Pixel color = m_Surface->get_buffer()[u + v * m_Pitch];
             if (color & 0xffffff)
             {
                 a_Target->get_buffer()[a_X + x + ((a_Y + y) * a_Target->get_pitch())] = color;
@@ -485,23 +534,32 @@ void Sprite::draw_scaled(int a_X, int a_Y, int a_Width, int a_Height, Surface* a
 
 void Sprite::initialize_start_data()
 {
+    m_Spans.clear();
+    m_RowSpans.clear();
+    m_RowSpans.reserve(m_NumFrames * m_Height + 1);
     for (unsigned int f = 0; f < m_NumFrames; ++f)
     {
-        m_Start[f] = new unsigned int[m_Height];
         for (int y = 0; y < m_Height; ++y)
         {
-            m_Start[f][y] = m_Width;
+            m_RowSpans.push_back((unsigned int)m_Spans.size());
             Pixel* addr = get_buffer() + f * m_Width + y * m_Pitch;
-            for (int x = 0; x < m_Width; ++x)
+            for (int x = 0; x < m_Width;)
             {
-                if (addr[x])
+                //Draw skips pixels without color
+                if (!(addr[x] & 0xffffff))
                 {
-                    m_Start[f][y] = x;
-                    break;
+                    ++x;
+                    continue;
                 }
+
+                int end = x + 1;
+                while (end < m_Width && (addr[end] & 0xffffff)) ++end;
+                m_Spans.push_back(Span{ (unsigned short)x, (unsigned short)(end - x) });
+                x = end;
             }
         }
     }
+    m_RowSpans.push_back((unsigned int)m_Spans.size());
 }
 
 Font::Font(const char* a_File, const char* a_Chars)
@@ -613,4 +671,33 @@ void Font::print(Surface* a_Target, const char* a_Text, int a_X, int a_Y, bool c
     }
 }
 
+void Font::print(Surface* a_Target, const char* a_Text, int a_X, int a_Y, int a_OriginX, int a_OriginY, int a_Pitch)
+{
+    Pixel* s = m_Surface->get_buffer();
+    if (((a_Y + m_Height) < m_CY1) || (a_Y > m_CY2)) return;
+    for (int cx = 0, i = 0; i < (int)strlen(a_Text); i++)
+    {
+        if (a_Text[i] == ' ')
+            cx += 4;
+        else
+        {
+            int c = m_Trans[(unsigned char)a_Text[i]];
+            Pixel* t = s + m_Offset[c];
+            for (int y = 0; y < m_Height; y++, t += m_Surface->get_pitch())
+            {
+                const int ty = a_Y + y - a_OriginY;
+                if (((a_Y + y) < m_CY1) || ((a_Y + y) > m_CY2) || (ty < 0) || (ty >= a_Target->get_height())) continue;
+                Pixel* d = a_Target->get_buffer() + ty * a_Target->get_pitch();
+                for (int x = 0; x < m_Width[c]; x++)
+                {
+                    const int tx = a_X + cx + x - a_OriginX;
+                    if ((t[x]) && (tx >= 0) && (tx < a_Target->get_width())) d[tx] = add_blend(t[x], d[tx]);
+                }
+            }
+            cx += m_Width[c] + 2;
+            if ((cx + a_X) >= a_Pitch) break;
+        }
+    }
+}
+
 }; // namespace Tmpl8
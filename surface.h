@@ -23,6 +23,16 @@ inline Pixel add_blend(Pixel a_Color1, Pixel a_Color2)
     return (r1 + g1 + b1);
 }
 
+// additive blending of count pixels, dst[i] = add_blend(dst[i], src[i])
+// add_blend saturates every color channel, so this is a saturating byte add (AVX2 or SSE2 when available)
+void add_blend_span(Pixel* dst, const Pixel* src, int count);
+
+// fill count pixels with color (AVX2 or SSE2 stores when available)
+void fill_span(Pixel* dst, Pixel color, size_t count);
+// same as fill_span, but with non-temporal stores that bypass the cache
+// for large fills that are not read again soon, a normal fill would first pull every line into the cache
+void stream_fill(Pixel* dst, Pixel color, size_t count);
+
 // subtractive blending
 inline Pixel sub_blend(Pixel a_Color1, Pixel a_Color2)
 {
@@ -70,6 +80,8 @@ class Surface
     void print(const char* a_String, int x1, int y1, Pixel color);
     void clear(Pixel a_Color);
     void line(float x1, float y1, float x2, float y2, Pixel color);
+    // Draw the line like line() does on a surface of a_Width x a_Height, of which this surface is the part at a_OriginX, a_OriginY
+    void line(float x1, float y1, float x2, float y2, Pixel color, int a_OriginX, int a_OriginY, int a_Width, int a_Height);
     void line(vec2 start, vec2 end, Pixel color);
     void plot(int x, int y, Pixel c);
     void load_image(const char* a_File);
@@ -78,6 +90,8 @@ class Surface
     void scale_color(unsigned int a_Scale);
     void box(int x1, int y1, int x2, int y2, Pixel color);
     void bar(int x1, int y1, int x2, int y2, Pixel color);
+    // Fill the rectangle [x1, x2) x [y1, y2) with color, clipped to the surface
+    void fill_rect(int x1, int y1, int x2, int y2, Pixel color);
     void resize(Surface* a_Orig);
 
   private:
@@ -92,6 +106,13 @@ class Surface
     int s_Transl[256];
 };
 
+// One draw of a sprite frame, sprite batches are lists of these
+struct SpriteDraw
+{
+    unsigned int frame;
+    int x, y;
+};
+
 class Sprite
 {
   public:
@@ -114,25 +135,39 @@ class Sprite
     Sprite(Surface* a_Surface, unsigned int a_NumFrames);
     ~Sprite();
     // Methods
-    void draw(Surface* a_Target, int a_X, int a_Y);
-    void draw_scaled(int a_X, int a_Y, int a_Width, int a_Height, Surface* a_Target);
+    // Drawing doesn't change the sprite, so a sprite can be drawn from several threads at once
+    void draw(Surface* a_Target, int a_X, int a_Y, unsigned int a_Frame = 0) const;
+    // Draw a frame, only touching the target pixels in [a_ClipX1, a_ClipX2) x [a_ClipY1, a_ClipY2)
+    // The clip rectangle has to lie within the target
+    void draw_clipped(Surface* a_Target, int a_X, int a_Y, unsigned int a_Frame, int a_ClipX1, int a_ClipY1, int a_ClipX2, int a_ClipY2) const;
+    // Draw a_Draws[a_Order[0]] up to a_Draws[a_Order[a_Count - 1]] in that order, clipped to the target
+    // The target is the part of a larger surface at a_OriginX, a_OriginY, the draws are in the coordinates of that surface
+    void draw_batch(Surface* a_Target, const SpriteDraw* a_Draws, const uint32_t* a_Order, size_t a_Count, int a_OriginX, int a_OriginY) const;
+    void draw_scaled(int a_X, int a_Y, int a_Width, int a_Height, Surface* a_Target, unsigned int a_Frame = 0) const;
     void set_flags(unsigned int a_Flags) { m_Flags = a_Flags; }
-    void set_frame(unsigned int a_Index) { m_CurrentFrame = a_Index; }
     unsigned int get_flags() const { return m_Flags; }
     int get_width() { return m_Width; }
     int get_height() { return m_Height; }
     Pixel* get_buffer() { return m_Surface->get_buffer(); }
     unsigned int frames() { return m_NumFrames; }
     Surface* get_surface() { return m_Surface; }
+    // Split every row of every frame into runs of opaque pixels, draw only copies those
+    // Call this again after changing the pixels of the surface
     void initialize_start_data();
 
   private:
+    // Run of opaque (non black) pixels in a row of a frame
+    struct Span
+    {
+        unsigned short x, length;
+    };
+
     // Attributes
     int m_Width, m_Height, m_Pitch;
     unsigned int m_NumFrames;
-    unsigned int m_CurrentFrame;
     unsigned int m_Flags;
-    unsigned int** m_Start;
+    std::vector<Span> m_Spans;
+    std::vector<unsigned int> m_RowSpans; // First span of every row, per frame, plus the end of the last row
     Surface* m_Surface;
 };
 
@@ -143,6 +178,8 @@ class Font
     Font(const char* a_File, const char* a_Chars);
     ~Font();
     void print(Surface* a_Target, const char* a_Text, int a_X, int a_Y, bool clip = false);
+    // Print like print() does on a surface with the given pitch, of which a_Target is the part at a_OriginX, a_OriginY
+    void print(Surface* a_Target, const char* a_Text, int a_X, int a_Y, int a_OriginX, int a_OriginY, int a_Pitch);
     void centre(Surface* a_Target, const char* a_Text, int a_Y);
     int width(const char* a_Text);
     int height() { return m_Surface->get_height(); }
@@ -4,60 +4,53 @@ namespace Tmpl8
 {
     class Terrain; //forward declare
 
-enum allignments
-{
-    BLUE,
-    RED
-};
-
+//Thin handle to a single tank in a TankStore
+//Copying a handle is cheap, all state lives in the store
 class Tank
 {
   public:
-    Tank(float pos_x, float pos_y, allignments allignment, Sprite* tank_sprite, Sprite* smoke_sprite, float tar_x, float tar_y, float collision_radius, int health, float max_speed);
-
-    ~Tank();
+    Tank(TankStore& store, uint32_t index) : store(&store), index(index) {}
 
     void tick(Terrain& terrain);
 
-    vec2 get_position() const { return position; };
-    float get_collision_radius() const { return collision_radius; };
-    bool rocket_reloaded() const { return reloaded; };
+    vec2 get_position() const { return position(); };
+    float get_collision_radius() const { return collision_radius(); };
+    bool rocket_reloaded() const { return reloaded(); };
+    uint32_t get_index() const { return index; };
 
-    void set_route(const std::vector<vec2>& route);
+    void set_flow_field(Terrain& terrain, int field);
     void reload_rocket();
 
     void deactivate();
     bool hit(int hit_value);
 
-    void draw(Surface* screen);
+    void draw(TileRenderer& renderer);
 
     int compare_health(const Tank& other) const;
 
     void push(vec2 direction, float magnitude);
 
-    vec2 position;
-    vec2 speed;
-    vec2 target;
-
-    vector<vec2> current_route;
-
-    int health;
-
-    float collision_radius;
-    vec2 force;
-
-    float max_speed;
-    float reload_time;
-
-    bool reloaded;
-    bool active;
-
-    allignments allignment;
-
-    int current_frame;
-    Sprite* tank_sprite;
-    Sprite* smoke_sprite;
-
+    //Fields of this tank in the store
+    vec2& position() const { return store->positions[index]; }
+    vec2& speed() const { return store->speeds[index]; }
+    vec2& target() const { return store->targets[index]; }
+    vec2& force() const { return store->forces[index]; }
+    int& health() const { return store->health[index]; }
+    float& collision_radius() const { return store->collision_radii[index]; }
+    float& max_speed() const { return store->max_speeds[index]; }
+    float& reload_time() const { return store->reload_times[index]; }
+    uint8_t& reloaded() const { return store->reloaded[index]; }
+    uint8_t& active() const { return store->active[index]; }
+    allignments& allignment() const { return store->alignments[index]; }
+    int& current_frame() const { return store->current_frames[index]; }
+    Sprite*& tank_sprite() const { return store->tank_sprites[index]; }
+    int& flow_field() const { return store->flow_fields[index]; }
+
+  private:
+    TankStore* store;
+    uint32_t index;
 };
 
-} // namespace Tmpl8
\ No newline at end of file
+inline Tank TankStore::operator[](size_t index) { return Tank(*this, (uint32_t)index); }
+
+} // namespace Tmpl8
@@ -0,0 +1,69 @@
+#include "precomp.h" // include (only) this in every .cpp file
+
+namespace Tmpl8
+{
+
+void TankStore::reserve(size_t num_tanks)
+{
+    positions.reserve(num_tanks);
+    speeds.reserve(num_tanks);
+    targets.reserve(num_tanks);
+    forces.reserve(num_tanks);
+    health.reserve(num_tanks);
+    damage.reserve(num_tanks);
+    collision_radii.reserve(num_tanks);
+    max_speeds.reserve(num_tanks);
+    reload_times.reserve(num_tanks);
+    reloaded.reserve(num_tanks);
+    active.reserve(num_tanks);
+    alignments.reserve(num_tanks);
+    current_frames.reserve(num_tanks);
+    tank_sprites.reserve(num_tanks);
+    flow_fields.reserve(num_tanks);
+}
+
+uint32_t TankStore::add(vec2 position, allignments allignment, Sprite* tank_sprite, vec2 target, float collision_radius, int tank_health, float max_speed)
+{
+    positions.push_back(position);
+    speeds.push_back(vec2(0));
+    targets.push_back(target);
+    forces.push_back(vec2(0, 0));
+    health.push_back(tank_health);
+    damage.push_back(0);
+    health_ranking.add(allignment, tank_health);
+    collision_radii.push_back(collision_radius);
+    max_speeds.push_back(max_speed);
+    reload_times.push_back(1);
+    reloaded.push_back(false);
+    active.push_back(true);
+    alignments.push_back(allignment);
+    current_frames.push_back(0);
+    tank_sprites.push_back(tank_sprite);
+    flow_fields.push_back(-1);
+
+    return (uint32_t)(positions.size() - 1);
+}
+
+void TankStore::add_damage(uint32_t tank, int amount)
+{
+    if (amount <= 0) return;
+
+    if (damage[tank] == 0) damaged_tanks.push_back(tank);
+    damage[tank] += amount;
+}
+
+//Every tank is hit at most once, so it can only be destroyed once no matter how many hits it collected
+void TankStore::apply_damage(std::vector<uint32_t>& destroyed)
+{
+    destroyed.clear();
+
+    for (uint32_t tank : damaged_tanks)
+    {
+        if (active[tank] && (*this)[tank].hit(damage[tank])) destroyed.push_back(tank);
+        damage[tank] = 0;
+    }
+
+    damaged_tanks.clear();
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,59 @@
+#pragma once
+
+namespace Tmpl8
+{
+class Tank; //forward declare
+
+enum allignments
+{
+    BLUE,
+    RED
+};
+
+// Structure-of-arrays storage for all tanks
+// Every tank property lives in its own contiguous array, so the hot loops (grid, collisions,
+// rockets, forcefield hull) only stream the fields they actually need through the cache.
+// Tank is a thin handle (store + index) for code that works on a single tank.
+class TankStore
+{
+  public:
+    void reserve(size_t num_tanks);
+
+    //Add a tank and return its index
+    uint32_t add(vec2 position, allignments allignment, Sprite* tank_sprite, vec2 target, float collision_radius, int health, float max_speed);
+
+    size_t size() const { return positions.size(); }
+    Tank operator[](size_t index); // Defined in tank.h
+
+    //Add damage to a tank, it only takes effect in apply_damage, not thread safe
+    void add_damage(uint32_t tank, int damage);
+    //Hit every damaged tank once with its accumulated damage, the tanks this destroys are written to destroyed
+    void apply_damage(std::vector<uint32_t>& destroyed);
+
+    std::vector<vec2> positions;
+    std::vector<vec2> speeds;
+    std::vector<vec2> targets;
+    std::vector<vec2> forces;
+
+    std::vector<int> health;
+    std::vector<int> damage; //Damage that add_damage collected since the last apply_damage
+    HealthRanking health_ranking; //Living tanks per team and health value, updated by Tank::hit
+    std::vector<float> collision_radii;
+    std::vector<float> max_speeds;
+    std::vector<float> reload_times;
+
+    std::vector<uint8_t> reloaded;
+    std::vector<uint8_t> active; //Not a vector<bool>, so tasks read plain bytes. Tanks are only deactivated by apply_damage, on one thread
+    std::vector<allignments> alignments;
+
+    std::vector<int> current_frames;
+    std::vector<Sprite*> tank_sprites;
+
+    //Terrain flow field every tank follows to its destination (-1 while it has no route)
+    std::vector<int> flow_fields;
+
+  private:
+    std::vector<uint32_t> damaged_tanks; //Tanks with damage, in the order they were first damaged
+};
+
+} // namespace Tmpl8
@@ -119,7 +119,6 @@ unsigned char* framedata = 0;
 #endif
 
 int ACTWIDTH, ACTHEIGHT;
-static bool firstframe = true;
 
 Surface* surface = 0;
 Game* game = 0;
@@ -216,9 +215,45 @@ void swap()
 
 #endif
 
+// The benchmark executables are built from the same sources and bring their own main (see benchmark.cpp, microbenchmark.cpp)
+#if !defined(TMPL8_BENCHMARK) && !defined(TMPL8_MICROBENCHMARK)
+
 int main(int argc, char** argv)
 {
     printf("application started.\n");
+
+    // command line: --headless [--frames N] runs the simulation without a window (N <= 0: max_frames)
+    //               --trace FILE records profiler spans and writes them as a Chrome trace on exit
+    //               --record-hashes FILE writes the state hash of every frame, --verify-hashes FILE
+    //               checks the run against such a file (a headless run exits with 1 if it diverged)
+    bool headless = false;
+    int headless_frames = 0;
+    const char* trace_file = nullptr;
+    const char* hash_file = nullptr;
+    HashLog::Mode hash_mode = HashLog::RECORD;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--headless") == 0) headless = true;
+        else if ((strcmp(argv[i], "--frames") == 0) && (i + 1 < argc)) headless_frames = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "--trace") == 0) && (i + 1 < argc)) trace_file = argv[++i];
+        else if ((strcmp(argv[i], "--record-hashes") == 0) && (i + 1 < argc)) hash_file = argv[++i], hash_mode = HashLog::RECORD;
+        else if ((strcmp(argv[i], "--verify-hashes") == 0) && (i + 1 < argc)) hash_file = argv[++i], hash_mode = HashLog::VERIFY;
+        else printf("unknown argument: %s\n", argv[i]);
+    }
+    if (trace_file) Profiler::enable();
+    HashLog hash_log;
+    if (hash_file && !hash_log.open(hash_file, hash_mode)) return 1;
+    if (headless)
+    {
+        game = new Game();
+        game->set_trace_file(trace_file);
+        game->set_hash_log(hash_file ? &hash_log : nullptr);
+        game->init();
+        game->run_headless(headless_frames);
+        game->shutdown();
+        return (hash_file && !hash_log.finish()) ? 1 : 0;
+    }
+
     SDL_Init(SDL_INIT_VIDEO);
 
 #ifdef ADVANCEDGL
@@ -239,48 +274,77 @@ int main(int argc, char** argv)
     surface = new Surface(SCRWIDTH, SCRHEIGHT);
     surface->clear(0);
     SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED /* | SDL_RENDERER_PRESENTVSYNC*/);
-    SDL_Texture* frameBuffer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SCRWIDTH, SCRHEIGHT);
+    // the game draws straight into a locked streaming texture when its pitch matches the surface,
+    // two textures are used in turn so locking the next one doesn't wait for the upload of the last frame
+    SDL_Texture* frameBuffers[2];
+    for (SDL_Texture*& frameBuffer : frameBuffers) frameBuffer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SCRWIDTH, SCRHEIGHT);
+    Pixel* surfaceBuffer = surface->get_buffer();
+    int frameBufferIndex = 0;
 #endif
     int exitapp = 0;
+    bool firstframe = true;
     game = new Game();
     game->set_target(surface);
+    game->set_trace_file(trace_file);
+    game->set_hash_log(hash_file ? &hash_log : nullptr);
     timer t;
     t.reset();
     while (!exitapp)
     {
 #ifdef ADVANCEDGL
         swap();
-        surface->SetBuffer((Pixel*)framedata);
+        surface->set_buffer((Pixel*)framedata);
+#endif
+#ifdef ADVANCEDGL
+        if (firstframe)
+        {
+            game->init();
+            firstframe = false;
+        }
+
+        // calculate frame time and pass it to game->Tick
+        game->tick(t.elapsed());
+        t.reset();
 #else
+        if (firstframe)
+        {
+            game->init();
+            firstframe = false;
+
+            // every later update runs while the frame before it is presented
+            game->tick_update(t.elapsed());
+            t.reset();
+        }
+
+        // the texture is only locked while the frame is drawn, the renderer writes every pixel and never reads
+        SDL_Texture* frameBuffer = frameBuffers[frameBufferIndex];
+        frameBufferIndex = (frameBufferIndex + 1) % 2;
         void* target = 0;
         int pitch;
         SDL_LockTexture(frameBuffer, NULL, &target, &pitch);
-        if (pitch == (surface->get_width() * 4))
-        {
-            memcpy(target, surface->get_buffer(), SCRWIDTH * SCRHEIGHT * 4);
-        }
-        else
+        const bool direct = (pitch == (surface->get_width() * 4));
+        surface->set_buffer(direct ? (Pixel*)target : surfaceBuffer);
+        game->tick_draw();
+        if (!direct)
         {
             unsigned char* t = (unsigned char*)target;
             for (int i = 0; i < SCRHEIGHT; i++)
             {
-                memcpy(t, surface->get_buffer() + i * SCRWIDTH, SCRWIDTH * 4);
+                memcpy(t, surfaceBuffer + i * SCRWIDTH, SCRWIDTH * 4);
                 t += pitch;
             }
         }
+        // the surface must not point into the texture once it is unlocked
+        surface->set_buffer(surfaceBuffer);
         SDL_UnlockTexture(frameBuffer);
+
+        // simulate the next frame on the thread pool while this one is presented
+        game->start_update(t.elapsed());
+        t.reset();
         SDL_RenderCopy(renderer, frameBuffer, NULL, NULL);
         SDL_RenderPresent(renderer);
+        game->wait_for_update();
 #endif
-        if (firstframe)
-        {
-            game->init();
-            firstframe = false;
-        }
-
-        // calculate frame time and pass it to game->Tick
-        game->tick(t.elapsed());
-        t.reset();
         // event loop
         SDL_Event event;
         while (SDL_PollEvent(&event))
@@ -316,6 +380,9 @@ int main(int argc, char** argv)
         }
     }
     game->shutdown();
+    if (hash_file) hash_log.finish();
     SDL_Quit();
     return 1;
 }
+
+#endif // !TMPL8_BENCHMARK && !TMPL8_MICROBENCHMARK
@@ -17,11 +17,25 @@ namespace Tmpl8
         tile_water = std::make_unique<Sprite>(water_img.get(), 1);
         tile_mountains = std::make_unique<Sprite>(mountains_img.get(), 1);
 
+        load("assets/terrain.txt");
+
+        background = std::make_unique<Surface>((int)(terrain_width * sprite_size), (int)(terrain_height * sprite_size));
+    }
+
+    bool Terrain::load(const std::string& file_path)
+    {
+        // Tiles the file doesn't mention are grass
+        for (auto& row : tiles)
+        {
+            for (TerrainTile& tile : row) tile.tile_type = TileType::GRASS;
+        }
+
         // Load terrain layout file
-        fs::path terrain_file_path{ "assets/terrain.txt" };
+        fs::path terrain_file_path{ file_path };
         std::ifstream terrain_file(terrain_file_path);
+        const bool loaded = terrain_file.is_open();
 
-        if (terrain_file.is_open())
+        if (loaded)
         {
             std::string terrain_line;
             std::getline(terrain_file, terrain_line);
@@ -30,10 +44,10 @@ namespace Tmpl8
             int rows;
             lineStream >> rows;
 
-            for (size_t row = 0; row < rows; row++)
+            for (size_t row = 0; row < std::min((size_t)rows, terrain_height); row++)
             {
                 std::getline(terrain_file, terrain_line);
-                for (size_t col = 0; col < terrain_line.size(); col++)
+                for (size_t col = 0; col < std::min(terrain_line.size(), terrain_width); col++)
                 {
                     switch (std::toupper(terrain_line.at(col)))
                     {
@@ -59,13 +73,40 @@ namespace Tmpl8
             {
                 tiles[y][x].position_x = x;
                 tiles[y][x].position_y = y;
-
-                if (is_accessible(y, x + 1)) tiles[y][x].exits.push_back(&tiles[y][x + 1]);
-                if (is_accessible(y, x - 1)) tiles[y][x].exits.push_back(&tiles[y][x - 1]);
-                if (is_accessible(y + 1, x)) tiles[y][x].exits.push_back(&tiles[y + 1][x]);
-                if (is_accessible(y - 1, x)) tiles[y][x].exits.push_back(&tiles[y - 1][x]);
+                update_exits(x, y);
             }
         }
+
+        for (FlowField& field : flow_fields) build_flow_field(field);
+        background_dirty = true;
+
+        return loaded;
+    }
+
+    void Terrain::update_exits(size_t x, size_t y)
+    {
+        tiles[y][x].exits.clear();
+        if (is_accessible(y, x + 1)) tiles[y][x].exits.push_back(&tiles[y][x + 1]);
+        if (is_accessible(y, x - 1)) tiles[y][x].exits.push_back(&tiles[y][x - 1]);
+        if (is_accessible(y + 1, x)) tiles[y][x].exits.push_back(&tiles[y + 1][x]);
+        if (is_accessible(y - 1, x)) tiles[y][x].exits.push_back(&tiles[y - 1][x]);
+    }
+
+    void Terrain::set_tile_type(size_t x, size_t y, TileType type)
+    {
+        if (tiles[y][x].tile_type == type) return;
+        tiles[y][x].tile_type = type;
+
+        // The accessibility of this tile decides the exits of its neighbors
+        update_exits(x, y);
+        if (x + 1 < terrain_width) update_exits(x + 1, y);
+        if (x > 0) update_exits(x - 1, y);
+        if (y + 1 < terrain_height) update_exits(x, y + 1);
+        if (y > 0) update_exits(x, y - 1);
+
+        for (FlowField& field : flow_fields) build_flow_field(field);
+
+        dirty_tiles.push_back((int)(y * terrain_width + x));
     }
 
     void Terrain::update()
@@ -73,48 +114,52 @@ namespace Tmpl8
         // Placeholder for future animations
     }
 
-    void Terrain::draw(Surface* target) const
+    void Terrain::draw(TileRenderer& renderer)
     {
-        for (size_t y = 0; y < tiles.size(); y++)
+        if (background_dirty)
         {
-            for (size_t x = 0; x < tiles[y].size(); x++)
+            background->clear(0);
+            for (size_t y = 0; y < tiles.size(); y++)
             {
-                int posX = x * sprite_size;
-                int posY = y * sprite_size;
-
-                switch (tiles[y][x].tile_type)
+                for (size_t x = 0; x < tiles[y].size(); x++)
                 {
-                case TileType::GRASS: tile_grass->draw(target, posX, posY); break;
-                case TileType::FORREST: tile_forest->draw(target, posX, posY); break;
-                case TileType::ROCKS: tile_rocks->draw(target, posX, posY); break;
-                case TileType::MOUNTAINS: tile_mountains->draw(target, posX, posY); break;
-                case TileType::WATER: tile_water->draw(target, posX, posY); break;
-                default: tile_grass->draw(target, posX, posY); break;
+                    draw_tile(background.get(), x, y);
                 }
             }
+            background_dirty = false;
         }
-    }
+        else
+        {
+            for (int tile : dirty_tiles)
+            {
+                size_t x = tile % terrain_width;
+                size_t y = tile / terrain_width;
 
-    // A node used in the A* algorithm to represent a tile in the search
-    struct Node
-    {
-        TerrainTile* tile;   // Pointer to the tile this node represents
-        float g_cost;        // Cost from the start tile to this node
-        float h_cost;        // Estimated cost (heuristic) from this node to the target
-        Node* parent;        // Pointer to the previous node in the path
+                // Tiles can have transparent pixels, clear the old tile first
+                background->bar((int)x * sprite_size, (int)y * sprite_size, (int)(x + 1) * sprite_size - 1, (int)(y + 1) * sprite_size - 1, 0);
+                draw_tile(background.get(), x, y);
+            }
+        }
+        dirty_tiles.clear();
 
-        // Total estimated cost of the path through this node
-        float f_cost() const { return g_cost + h_cost; }
-    };
+        renderer.draw_surface(background.get(), 0, 0);
+    }
 
+    void Terrain::draw_tile(Surface* target, size_t x, size_t y) const
+    {
+        int posX = x * sprite_size;
+        int posY = y * sprite_size;
 
-    // Comparison function used in the priority queue to sort nodes by lowest f_cost
-    struct Compare_nodes {
-        bool operator()(const Node* a, const Node* b) {
-            return a->f_cost() > b->f_cost(); // Lower f_cost has higher priority
+        switch (tiles[y][x].tile_type)
+        {
+        case TileType::GRASS: tile_grass->draw(target, posX, posY); break;
+        case TileType::FORREST: tile_forest->draw(target, posX, posY); break;
+        case TileType::ROCKS: tile_rocks->draw(target, posX, posY); break;
+        case TileType::MOUNTAINS: tile_mountains->draw(target, posX, posY); break;
+        case TileType::WATER: tile_water->draw(target, posX, posY); break;
+        default: tile_grass->draw(target, posX, posY); break;
         }
-    };
-
+    }
 
     // Heuristic function: estimates distance from a to b using Manhattan distance
     float Terrain::heuristic(const TerrainTile* a, const TerrainTile* b) {
@@ -122,76 +167,251 @@ namespace Tmpl8
             std::abs((float)a->position_y - b->position_y);
     }
 
+    // Heap order: lowest f_cost first, ties go to the tile that is furthest along (highest g_cost)
+    bool Terrain::heap_less(int a, int b) const {
+        if (f_costs[a] != f_costs[b]) return f_costs[a] < f_costs[b];
+        return g_costs[a] > g_costs[b];
+    }
+
+    void Terrain::heap_push(int tile) {
+        heap_index[tile] = (int)open_heap.size();
+        open_heap.push_back(tile);
+        heap_sift_up(heap_index[tile]);
+    }
+
+    // Restore the heap after the cost of an open tile decreased
+    void Terrain::heap_update(int tile) {
+        heap_sift_up(heap_index[tile]);
+    }
+
+    int Terrain::heap_pop() {
+        int top = open_heap.front();
+        open_heap.front() = open_heap.back();
+        heap_index[open_heap.front()] = 0;
+        open_heap.pop_back();
+        if (!open_heap.empty()) heap_sift_down(0);
+        return top;
+    }
+
+    void Terrain::heap_sift_up(int position) {
+        int tile = open_heap[position];
+        while (position > 0)
+        {
+            int parent = (position - 1) / 2;
+            if (!heap_less(tile, open_heap[parent])) break;
+            open_heap[position] = open_heap[parent];
+            heap_index[open_heap[position]] = position;
+            position = parent;
+        }
+        open_heap[position] = tile;
+        heap_index[tile] = position;
+    }
+
+    void Terrain::heap_sift_down(int position) {
+        int tile = open_heap[position];
+        const int size = (int)open_heap.size();
+        while (true)
+        {
+            int child = position * 2 + 1;
+            if (child >= size) break;
+            if (child + 1 < size && heap_less(open_heap[child + 1], open_heap[child])) child++;
+            if (!heap_less(open_heap[child], tile)) break;
+            open_heap[position] = open_heap[child];
+            heap_index[open_heap[position]] = position;
+            position = child;
+        }
+        open_heap[position] = tile;
+        heap_index[tile] = position;
+    }
+
 	// A* pathfinding algorithm
-    std::vector<vec2> Terrain::get_route(const Tank& tank, const vec2& target) {
+    // All search state lives in flat per tile arrays, so a search doesn't allocate anything apart from the route itself
+    void Terrain::get_route(const Tank& tank, const vec2& target, std::vector<vec2>& route) {
+        route.clear();
+
         // Convert pixel coordinates to grid indices (tile positions)
-        size_t start_x = tank.position.x / sprite_size;
-        size_t start_y = tank.position.y / sprite_size;
+        size_t start_x = tank.get_position().x / sprite_size;
+        size_t start_y = tank.get_position().y / sprite_size;
         size_t target_x = target.x / sprite_size;
         size_t target_y = target.y / sprite_size;
 
         // Get pointers to the starting and target tiles
-        TerrainTile* start_tile = &tiles[start_y][start_x];
-        TerrainTile* target_tile = &tiles[target_y][target_x];
-
-        // Open set: priority queue for nodes to be evaluated (sorted by estimated cost)
-        std::priority_queue<Node*, std::vector<Node*>, Compare_nodes> open_set;
+        const TerrainTile* start_tile = &tiles[start_y][start_x];
+        const TerrainTile* target_tile = &tiles[target_y][target_x];
+        const int target_index = tile_index(target_tile);
 
-        // Map to store all created nodes for memory management and path lookup
-        std::unordered_map<TerrainTile*, Node*> all_nodes;
-
-        // Create the starting node with g_cost = 0 and h_cost from heuristic
-        Node* start_node = new Node{ start_tile, 0, heuristic(start_tile, target_tile), nullptr };
-        open_set.push(start_node);
-        all_nodes[start_tile] = start_node;
-
-        // Main loop: continue until there are no more nodes to evaluate
-        while (!open_set.empty())
+        // Start a new search, which invalidates the state of all previous searches
+        if (++search_generation == 0)
+        {
+            visit_generation.fill(0);
+            closed_generation.fill(0);
+            search_generation = 1;
+        }
+        open_heap.clear();
+        open_heap.reserve(num_tiles);
+
+        // Open the starting tile with g_cost = 0 and h_cost from heuristic
+        const int start_index = tile_index(start_tile);
+        g_costs[start_index] = 0.f;
+        f_costs[start_index] = heuristic(start_tile, target_tile);
+        parents[start_index] = -1;
+        visit_generation[start_index] = search_generation;
+        heap_push(start_index);
+
+        // Main loop: continue until there are no more tiles to evaluate
+        while (!open_heap.empty())
         {
-            // Get the node with the lowest estimated total cost (g + h)
-            Node* current = open_set.top();
-            open_set.pop();
+            // Get the tile with the lowest estimated total cost (g + h)
+            const int current = heap_pop();
+            closed_generation[current] = search_generation;
 
             // If we reached the goal, reconstruct the path
-            if (current->tile == target_tile)
+            if (current == target_index)
             {
-                std::vector<vec2> path;
-                while (current)
+                // Every step costs one, so the path holds g_cost + 1 tiles and can be filled back to front
+                route.resize((size_t)g_costs[current] + 1);
+                size_t slot = route.size();
+                for (int tile = current; tile != -1; tile = parents[tile])
                 {
                     // Convert tile coordinates back to pixel positions
-                    path.emplace_back(current->tile->position_x * sprite_size,
-                        current->tile->position_y * sprite_size);
-                    current = current->parent;
+                    route[--slot] = vec2((float)((tile % terrain_width) * sprite_size), (float)((tile / terrain_width) * sprite_size));
                 }
-                // Reverse the path to start from the beginning
-                std::reverse(path.begin(), path.end());
-
-                // Free memory for all created nodes
-                for (auto& node : all_nodes) delete node.second;
-
-                return path; // Return the final path
+                return;
             }
 
             // Loop through all neighboring tiles (accessible neighbors)
-            for (TerrainTile* neighbor : current->tile->exits)
+            const TerrainTile* current_tile = &tiles[current / terrain_width][current % terrain_width];
+            for (const TerrainTile* neighbor_tile : current_tile->exits)
             {
-                float new_g_cost = current->g_cost + 1.0f; // Cost from start to neighbor (assumes uniform cost)
+                const int neighbor = tile_index(neighbor_tile);
+                if (closed_generation[neighbor] == search_generation) continue;
+
+                float new_g_cost = g_costs[current] + 1.0f; // Cost from start to neighbor (assumes uniform cost)
 
-                // If neighbor has not been visited or a shorter path is found
-                if (!all_nodes.count(neighbor) || new_g_cost < all_nodes[neighbor]->g_cost)
+                if (visit_generation[neighbor] != search_generation)
                 {
-                    // Create a new node for this neighbor with updated costs and parent
-                    Node* new_node = new Node{ neighbor, new_g_cost, heuristic(neighbor, target_tile), current };
-                    open_set.push(new_node); // Add it to the open set
-                    all_nodes[neighbor] = new_node; // Save it in the map
+                    // First time this search reaches the neighbor
+                    visit_generation[neighbor] = search_generation;
+                    g_costs[neighbor] = new_g_cost;
+                    f_costs[neighbor] = new_g_cost + heuristic(neighbor_tile, target_tile);
+                    parents[neighbor] = current;
+                    heap_push(neighbor);
                 }
+                else if (new_g_cost < g_costs[neighbor])
+                {
+                    // Shorter path to an open tile, move it up in the heap instead of adding a duplicate
+                    f_costs[neighbor] -= g_costs[neighbor] - new_g_cost;
+                    g_costs[neighbor] = new_g_cost;
+                    parents[neighbor] = current;
+                    heap_update(neighbor);
+                }
+            }
+        }
+
+        // No path found, the route stays empty
+    }
+
+    int Terrain::get_flow_field(const vec2& destination)
+    {
+        const size_t goal_column = std::min((size_t)std::max(destination.x / sprite_size, 0.f), terrain_width - 1);
+
+        for (size_t i = 0; i < flow_fields.size(); i++)
+        {
+            if (flow_fields[i].goal_column == goal_column) return (int)i;
+        }
+
+        flow_fields.emplace_back();
+        flow_fields.back().goal_column = goal_column;
+        build_flow_field(flow_fields.back());
+        return (int)flow_fields.size() - 1;
+    }
+
+    // Breadth first search from all goal tiles at once, every step costs one just like in get_route
+    // Tiles are visited backwards: a tile can step to its neighbor if that neighbor is accessible,
+    // so inaccessible tiles get a distance (a tank standing there can still leave) but are never expanded
+    void Terrain::build_flow_field(FlowField& field)
+    {
+        field.distances.fill(unreachable_distance);
+
+        // The heap is not in use between searches, so it doubles as the breadth first queue
+        std::vector<int>& queue = open_heap;
+        queue.clear();
+        queue.reserve(num_tiles);
+
+        for (size_t y = 0; y < terrain_height; y++)
+        {
+            if (is_accessible((int)y, (int)field.goal_column))
+            {
+                const int tile = (int)(y * terrain_width + field.goal_column);
+                field.distances[tile] = 0;
+                queue.push_back(tile);
             }
         }
 
-        // No path found: clean up all allocated nodes
-        for (auto& node : all_nodes) delete node.second;
+        for (size_t head = 0; head < queue.size(); head++)
+        {
+            const int tile = queue[head];
+            const int x = tile % terrain_width;
+            const int y = tile / terrain_width;
+            const uint16_t distance = field.distances[tile] + 1;
+
+            const int neighbors[4][2] = { { x + 1, y }, { x - 1, y }, { x, y + 1 }, { x, y - 1 } };
+            for (const auto& neighbor : neighbors)
+            {
+                if (neighbor[0] < 0 || neighbor[0] >= (int)terrain_width || neighbor[1] < 0 || neighbor[1] >= (int)terrain_height) continue;
+
+                const int neighbor_tile = neighbor[1] * terrain_width + neighbor[0];
+                if (field.distances[neighbor_tile] != unreachable_distance) continue;
+
+                field.distances[neighbor_tile] = distance;
+                if (is_accessible(neighbor[1], neighbor[0])) queue.push_back(neighbor_tile);
+            }
+        }
+
+        queue.clear();
+    }
+
+    int Terrain::tile_index_at(const vec2& position) const
+    {
+        // Tanks can be pushed off the map, they route from the closest border tile
+        const size_t x = std::min((size_t)std::max(position.x / sprite_size, 0.f), terrain_width - 1);
+        const size_t y = std::min((size_t)std::max(position.y / sprite_size, 0.f), terrain_height - 1);
+        return (int)(y * terrain_width + x);
+    }
+
+    vec2 Terrain::get_tile_position(const vec2& position) const
+    {
+        const int tile = tile_index_at(position);
+        return vec2((float)((tile % terrain_width) * sprite_size), (float)((tile / terrain_width) * sprite_size));
+    }
+
+    bool Terrain::is_reachable(int field, const vec2& position) const
+    {
+        return flow_fields[field].distances[tile_index_at(position)] != unreachable_distance;
+    }
+
+    vec2 Terrain::next_waypoint(int field, const vec2& position) const
+    {
+        const std::array<uint16_t, num_tiles>& distances = flow_fields[field].distances;
+        const int tile = tile_index_at(position);
+        const TerrainTile* current_tile = &tiles[tile / terrain_width][tile % terrain_width];
+
+        // Step to the neighbor closest to the goal, the first exit wins ties
+        const TerrainTile* next_tile = current_tile;
+        uint16_t next_distance = distances[tile];
+        if (next_distance != unreachable_distance)
+        {
+            for (const TerrainTile* neighbor : current_tile->exits)
+            {
+                if (distances[tile_index(neighbor)] < next_distance)
+                {
+                    next_tile = neighbor;
+                    next_distance = distances[tile_index(neighbor)];
+                }
+            }
+        }
 
-        return {}; // Return empty path if unreachable
+        return vec2((float)(next_tile->position_x * sprite_size), (float)(next_tile->position_y * sprite_size));
     }
 
 	float Terrain::get_speed_modifier(const vec2& position) const {
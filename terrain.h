@@ -24,19 +24,77 @@ namespace Tmpl8
     {
     public:
         Terrain();
+        //Replace the layout with the one in the file (a row count, then one letter per tile), false if it can't be read
+        //Not thread safe, don't call this while tanks are moving
+        bool load(const std::string& file_path);
         void update();
-        void draw(Surface* target) const;
+        //Copy the pre-rendered terrain to the screen, redrawing the tiles that changed first
+        void draw(TileRenderer& renderer);
+        //Change the type of a tile, the routes and the pre-rendered terrain are updated
+        //Not thread safe, don't call this while tanks are moving
+        void set_tile_type(size_t x, size_t y, TileType type);
         //Use A* search to find shortest route to the destination
-        vector<vec2> get_route(const Tank& tank, const vec2& target);
+        //The route is written to the given vector (empty if unreachable), reusing its memory
+        //Not thread safe, all searches share the search state of the terrain
+        void get_route(const Tank& tank, const vec2& target, vector<vec2>& route);
+
+        //Flow fields: one distance field per destination region (the tile column of the destination),
+        //shared by all tanks that head there. Returns the id of the field, building it on first use
+        int get_flow_field(const vec2& destination);
+        //Can the destination region of the field be reached from this position
+        bool is_reachable(int field, const vec2& position) const;
+        //Next tile (in pixels) to move to from the tile of the given position, following the gradient of the field
+        //Returns the tile itself once it is part of the destination region or can't reach it
+        vec2 next_waypoint(int field, const vec2& position) const;
+        //Top left corner (in pixels) of the tile at the given position
+        vec2 get_tile_position(const vec2& position) const;
         float get_speed_modifier(const vec2& position) const;
 
     private:
         bool is_accessible(int y, int x);
+        void update_exits(size_t x, size_t y);
+        void draw_tile(Surface* target, size_t x, size_t y) const;
         float heuristic(const TerrainTile* a, const TerrainTile* b);
 
         static constexpr int sprite_size = 16;
         static constexpr size_t terrain_width = 80;
         static constexpr size_t terrain_height = 45;
+        static constexpr size_t num_tiles = terrain_width * terrain_height;
+
+        //Tiles are identified by y * terrain_width + x in the search state
+        int tile_index(const TerrainTile* tile) const { return (int)(tile->position_y * terrain_width + tile->position_x); }
+
+        //Indexed binary min heap on f cost, heap_index holds the position of every open tile in the heap
+        bool heap_less(int a, int b) const;
+        void heap_push(int tile);
+        void heap_update(int tile);
+        int heap_pop();
+        void heap_sift_up(int position);
+        void heap_sift_down(int position);
+
+        //A* search state, one entry per tile, allocated once with the terrain
+        //A tile is only valid in the current search if its generation matches search_generation,
+        //so nothing has to be cleared between searches
+        std::array<float, num_tiles> g_costs;
+        std::array<float, num_tiles> f_costs;
+        std::array<int, num_tiles> parents;
+        std::array<int, num_tiles> heap_index;
+        std::array<uint32_t, num_tiles> visit_generation{};  //Tile was reached in this search
+        std::array<uint32_t, num_tiles> closed_generation{}; //Tile was expanded in this search
+        uint32_t search_generation = 0;
+        std::vector<int> open_heap;
+
+        //Steps from every tile to the closest accessible tile in goal_column, unreachable_distance if there is no path
+        static constexpr uint16_t unreachable_distance = 0xFFFF;
+        struct FlowField
+        {
+            size_t goal_column;
+            std::array<uint16_t, num_tiles> distances;
+        };
+        void build_flow_field(FlowField& field);
+        int tile_index_at(const vec2& position) const;
+
+        std::vector<FlowField> flow_fields;
 
         std::unique_ptr<Surface> grass_img;
         std::unique_ptr<Surface> forest_img;
@@ -51,5 +109,11 @@ namespace Tmpl8
         std::unique_ptr<Sprite> tile_water;
 
         std::array<std::array<TerrainTile, terrain_width>, terrain_height> tiles;
+
+        //The terrain rarely changes, so it is rendered once and copied to the screen every frame
+        //Changed tiles are redrawn individually, the whole terrain only on the first draw
+        std::unique_ptr<Surface> background;
+        std::vector<int> dirty_tiles;
+        bool background_dirty = true;
     };
 }
\ No newline at end of file
@@ -5,95 +5,315 @@ namespace Tmpl8
 
 class ThreadPool; //Forward declare
 
-class Worker;
+//Counts the unfinished tasks of a batch, ThreadPool::wait returns once it reaches zero
+//Waiting on a group replaces one future (and its shared state allocation) per task
+class TaskGroup
+{
+  public:
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+  private:
+    friend class ThreadPool;
+    std::atomic<int> pending{ 0 };
+};
 
 class Worker
 {
   public:
     //Instantiate the worker class by passing and storing the threadpool as a reference
-    Worker(ThreadPool& s) : pool(s) {}
+    Worker(ThreadPool& s, size_t index) : pool(s), index(index) {}
 
     inline void operator()();
 
   private:
     ThreadPool& pool;
+    size_t index; //Index of the work queue owned by this worker
 };
 
+//Work stealing thread pool
+//Every worker owns a double ended queue: it pushes and pops new work at the back,
+//idle workers (and threads waiting on a group) steal the oldest work from the front of other queues.
+//With zero threads every task runs directly on the calling thread, in submission order.
 class ThreadPool
 {
   public:
-    ThreadPool(size_t numThreads) : stop(false)
+    ThreadPool(size_t numThreads) : num_queues(numThreads), queues(new WorkQueue[std::max<size_t>(numThreads, 1)])
     {
         for (size_t i = 0; i < numThreads; ++i)
-            workers.push_back(std::thread(Worker(*this)));
+            workers.push_back(std::thread(Worker(*this, i)));
     }
 
     ~ThreadPool()
     {
-        stop = true; // stop all threads
+        {
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            stop = true; // stop all threads
+        }
         condition.notify_all();
 
         for (auto& thread : workers)
             thread.join();
     }
 
+    size_t num_threads() const { return num_queues; }
+
+    //Schedule a task as part of the given group
     template <class T>
-    auto enqueue(T task) -> std::future<decltype(task())>
+    void run(TaskGroup& group, T task)
     {
-        //Wrap the function in a packaged_task so we can return a future object
-        auto wrapper = std::make_shared<std::packaged_task<decltype(task())()>>(std::move(task));
+        group.pending.fetch_add(1, std::memory_order_relaxed);
 
-        //Scope to restrict critical section
+        if (num_queues == 0)
         {
-            //lock our queue and add the given task to it
-            std::unique_lock<std::mutex> lock(queue_mutex);
-
-            tasks.push_back([=] {
-                (*wrapper)();
-            });
+            execute(Task{ std::move(task), &group });
+            return;
         }
 
-        //Wake up a thread to start this task
-        condition.notify_one();
+        push(Task{ std::move(task), &group });
+    }
+
+    //Wait until all tasks of the group are finished, the calling thread executes queued tasks in the meantime
+    inline void wait(TaskGroup& group);
 
-        return wrapper->get_future();
+    //Split [begin, end) into chunks of at most grain items and call body(chunk_begin, chunk_end) for each chunk in parallel
+    //Chunks are claimed from a shared counter, so no task is created per chunk and the calling thread helps out
+    template <class F>
+    void parallel_for(size_t begin, size_t end, size_t grain, F body)
+    {
+        if (begin >= end) return;
+
+        grain = std::max<size_t>(grain, 1);
+        const size_t num_chunks = (end - begin + grain - 1) / grain;
+
+        std::atomic<size_t> next_chunk{ 0 };
+        auto run_chunks = [&]() {
+            for (size_t chunk = next_chunk++; chunk < num_chunks; chunk = next_chunk++)
+            {
+                const size_t chunk_begin = begin + chunk * grain;
+                body(chunk_begin, std::min(chunk_begin + grain, end));
+            }
+        };
+
+        //At most one helper per chunk that the calling thread won't get to first
+        TaskGroup group;
+        const size_t num_helpers = std::min(num_chunks - 1, num_queues);
+        for (size_t i = 0; i < num_helpers; i++)
+        {
+            run(group, [&run_chunks]() { run_chunks(); });
+        }
+
+        run_chunks();
+        wait(group);
     }
 
   private:
     friend class Worker; //Gives access to the private variables of this class
 
+    struct Task
+    {
+        std::function<void()> function;
+        TaskGroup* group;
+    };
+
+    //Aligned to a cache line so workers don't share the line of their queue lock
+    struct alignas(64) WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    //Index of the queue owned by the calling thread, or -1 if it is not a worker of this pool
+    int own_queue() const { return (current_pool == this) ? current_worker : -1; }
+
+    inline void push(Task task);
+    inline bool pop(Task& task);
+    inline void execute(Task task);
+
     std::vector<std::thread> workers;
-    std::deque<std::function<void()>> tasks;
+    const size_t num_queues; //One per worker, fixed before the workers start so they can read it without locking
+    std::unique_ptr<WorkQueue[]> queues;
 
-    std::condition_variable condition; //Wakes up a thread when work is available
+    std::atomic<int> queued_tasks{ 0 };   //Tasks in all queues, sleeping workers wake up when this is non-zero
+    std::atomic<size_t> next_queue{ 0 };  //Round robin queue for tasks submitted by non-worker threads
 
-    std::mutex queue_mutex; //Lock for our queue
+    std::condition_variable condition; //Wakes up a thread when work is available
+    std::mutex sleep_mutex;            //Lock for sleeping and waking up workers
     bool stop = false;
+
+    static inline thread_local ThreadPool* current_pool = nullptr;
+    static inline thread_local int current_worker = -1;
 };
 
+//Workers push to their own queue, other threads spread their tasks over all queues
+inline void ThreadPool::push(Task task)
+{
+    int queue = own_queue();
+    if (queue < 0) queue = (int)(next_queue++ % num_queues);
+
+    {
+        std::unique_lock<std::mutex> lock(queues[queue].mutex);
+        queues[queue].tasks.push_back(std::move(task));
+    }
+    queued_tasks++;
+
+    //Take the sleep lock so a worker can't miss the wake up between checking for work and going to sleep
+    {
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+    }
+    condition.notify_one();
+}
+
+//Pop the newest task of our own queue, otherwise steal the oldest task of another queue
+inline bool ThreadPool::pop(Task& task)
+{
+    const int own = own_queue();
+
+    if (own >= 0)
+    {
+        std::unique_lock<std::mutex> lock(queues[own].mutex);
+        if (!queues[own].tasks.empty())
+        {
+            task = std::move(queues[own].tasks.back());
+            queues[own].tasks.pop_back();
+            queued_tasks--;
+            return true;
+        }
+    }
+
+    const size_t first = (own >= 0) ? own + 1 : 0;
+    for (size_t i = 0; i < num_queues; i++)
+    {
+        WorkQueue& victim = queues[(first + i) % num_queues];
+        std::unique_lock<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued_tasks--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline void ThreadPool::execute(Task task)
+{
+    {
+        ScopedTimer task_timer("pool task");
+        task.function();
+    }
+    task.group->pending.fetch_sub(1, std::memory_order_release);
+}
+
+inline void ThreadPool::wait(TaskGroup& group)
+{
+    Task task;
+    while (!group.done())
+    {
+        if (pop(task))
+            execute(std::move(task));
+        else
+            std::this_thread::yield();
+    }
+}
+
 inline void Worker::operator()()
 {
-    std::function<void()> task;
+    ThreadPool::current_pool = &pool;
+    ThreadPool::current_worker = (int)index;
+
+    ThreadPool::Task task;
     while (true)
     {
+        if (pool.pop(task))
+        {
+            pool.execute(std::move(task));
+            continue;
+        }
+
         //Scope to restrict critical section
-        //This is important because we don't want to hold the lock while executing the task,
-        //because that would make it so only one task can be run simultaneously (aka sequantial)
         {
-            std::unique_lock<std::mutex> locker(pool.queue_mutex);
+            std::unique_lock<std::mutex> locker(pool.sleep_mutex);
 
             //Wait until some work is ready or we are stopping the threadpool
             //Because of spurious wakeups we need to check if there is actually a task available or we are stopping
-            pool.condition.wait(locker, [=] { return pool.stop || !pool.tasks.empty(); });
+            pool.condition.wait(locker, [this] { return pool.stop || pool.queued_tasks > 0; });
 
-            if (pool.stop) break;
+            if (pool.stop && pool.queued_tasks == 0) break;
+        }
+    }
+}
 
-            task = pool.tasks.front();
-            pool.tasks.pop_front();
+//A set of tasks with dependencies between them, executed on a thread pool without futures
+//The graph is built once and can be run again every frame
+class TaskGraph
+{
+  public:
+    //Add a task to the graph and return its id
+    size_t add(std::function<void()> task)
+    {
+        nodes.push_back(Node{ std::move(task), {}, 0 });
+        return nodes.size() - 1;
+    }
+
+    //The task will only start after the dependency finished
+    void add_dependency(size_t task, size_t dependency)
+    {
+        nodes[dependency].successors.push_back(task);
+        nodes[task].num_dependencies++;
+    }
+
+    //Run all tasks of the graph and return when they are all finished
+    void run(ThreadPool& thread_pool)
+    {
+        if (num_counters < nodes.size())
+        {
+            remaining_dependencies.reset(new std::atomic<int>[nodes.size()]);
+            num_counters = nodes.size();
         }
+        for (size_t i = 0; i < nodes.size(); i++) remaining_dependencies[i] = nodes[i].num_dependencies;
 
-        task();
+        TaskGroup group;
+        pool = &thread_pool;
+        running_group = &group;
+
+        for (size_t i = 0; i < nodes.size(); i++)
+        {
+            if (nodes[i].num_dependencies == 0) pool->run(group, [this, i]() { run_node(i); });
+        }
+
+        pool->wait(group);
     }
-}
 
-} // namespace Tmpl8
\ No newline at end of file
+  private:
+    struct Node
+    {
+        std::function<void()> task;
+        std::vector<size_t> successors;
+        int num_dependencies;
+    };
+
+    //Run a task, then schedule the successors it was the last dependency of
+    void run_node(size_t node)
+    {
+        nodes[node].task();
+
+        for (size_t successor : nodes[node].successors)
+        {
+            if (remaining_dependencies[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                pool->run(*running_group, [this, successor]() { run_node(successor); });
+            }
+        }
+    }
+
+    std::vector<Node> nodes;
+    std::unique_ptr<std::atomic<int>[]> remaining_dependencies;
+    size_t num_counters = 0;
+
+    ThreadPool* pool = nullptr;
+    TaskGroup* running_group = nullptr;
+};
+
+} // namespace Tmpl8
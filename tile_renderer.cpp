@@ -0,0 +1,173 @@
+#include "precomp.h" // include (only) this in every .cpp file
+
+namespace Tmpl8
+{
+
+TileRenderer::TileRenderer(int width, int height, int tile_size)
+    : width(width), height(height), tile_size(tile_size), tiles_x((width + tile_size - 1) / tile_size), tiles_y((height + tile_size - 1) / tile_size)
+{
+    bins.resize(tiles_x * tiles_y);
+}
+
+void TileRenderer::begin(Pixel color)
+{
+    clear_color = color;
+    batches.clear();
+    draws.clear();
+    draw_batches.clear();
+    shapes.clear();
+    texts.clear();
+
+    //Bins are only cleared, so they keep their memory between frames
+    for (std::vector<uint32_t>& bin : bins) bin.clear();
+}
+
+void TileRenderer::draw_surface(Surface* surface, int x, int y)
+{
+    add(Batch{ DrawType::SURFACE, surface, nullptr, 0 }, SpriteDraw{ 0, x, y }, x, y, x + surface->get_width(), y + surface->get_height());
+}
+
+void TileRenderer::draw_sprite(Sprite* sprite, unsigned int frame, int x, int y)
+{
+    add(Batch{ DrawType::SPRITE, nullptr, sprite, 0 }, SpriteDraw{ frame, x, y }, x, y, x + sprite->get_width(), y + sprite->get_height());
+}
+
+void TileRenderer::draw_line(const vec2& start, const vec2& end, Pixel color)
+{
+    //The stepping of Surface::line can end a pixel past the end points, so the bounds get a pixel of margin
+    const int x1 = (int)std::floor(std::min(start.x, end.x)) - 1, x2 = (int)std::floor(std::max(start.x, end.x)) + 2;
+    const int y1 = (int)std::floor(std::min(start.y, end.y)) - 1, y2 = (int)std::floor(std::max(start.y, end.y)) + 2;
+
+    add(Batch{ DrawType::LINE, nullptr, nullptr, (uint32_t)shapes.size() }, SpriteDraw{ 0, x1, y1 }, x1, y1, x2, y2);
+    shapes.push_back(Shape{ start.x, start.y, end.x, end.y, color });
+}
+
+void TileRenderer::draw_bar(int x1, int y1, int x2, int y2, Pixel color)
+{
+    add(Batch{ DrawType::BAR, nullptr, nullptr, (uint32_t)shapes.size() }, SpriteDraw{ 0, x1, y1 }, x1, y1, x2 + 1, y2 + 1);
+    shapes.push_back(Shape{ (float)x1, (float)y1, (float)x2, (float)y2, color });
+}
+
+void TileRenderer::draw_text(Font* font, const char* text, int x, int y)
+{
+    add(Batch{ DrawType::TEXT, nullptr, nullptr, (uint32_t)texts.size() }, SpriteDraw{ 0, x, y }, x, y, x + font->width(text), y + font->height());
+    texts.push_back(Text{ font, text, x, y });
+}
+
+//Add the draw to the bins of all tiles its rectangle overlaps, draws that are entirely off screen are dropped
+void TileRenderer::add(const Batch& batch, const SpriteDraw& draw, int x1, int y1, int x2, int y2)
+{
+    x1 = std::max(x1, 0), x2 = std::min(x2, width);
+    y1 = std::max(y1, 0), y2 = std::min(y2, height);
+    if ((x2 <= x1) || (y2 <= y1)) return;
+
+    //Only consecutive draws of the same sprite share a batch
+    if ((batch.type != DrawType::SPRITE) || batches.empty() || (batches.back().sprite != batch.sprite)) batches.push_back(batch);
+
+    const uint32_t index = (uint32_t)draws.size();
+    draws.push_back(draw);
+    draw_batches.push_back((uint32_t)batches.size() - 1);
+
+    for (int tile_y = y1 / tile_size; tile_y <= (y2 - 1) / tile_size; tile_y++)
+    {
+        for (int tile_x = x1 / tile_size; tile_x <= (x2 - 1) / tile_size; tile_x++)
+        {
+            bins[tile_y * tiles_x + tile_x].push_back(index);
+        }
+    }
+}
+
+void TileRenderer::render(Surface* target, ThreadPool& thread_pool)
+{
+    const size_t num_tasks = (bins.size() + tiles_per_task - 1) / tiles_per_task;
+    scratch_tiles.resize(num_tasks * tile_size * tile_size);
+
+    //Tiles don't share pixels, so they need no synchronization
+    thread_pool.parallel_for(0, bins.size(), tiles_per_task, [this, target](size_t begin, size_t end) {
+        Pixel* scratch = &scratch_tiles[(begin / tiles_per_task) * tile_size * tile_size];
+        for (size_t tile = begin; tile < end; tile++) render_tile(target, (int)tile, scratch);
+    });
+}
+
+void TileRenderer::render_tile(Surface* target, int tile, Pixel* scratch) const
+{
+    const int x1 = (tile % tiles_x) * tile_size, x2 = std::min(x1 + tile_size, width);
+    const int y1 = (tile / tiles_x) * tile_size, y2 = std::min(y1 + tile_size, height);
+
+    //The tile is drawn in tile coordinates, the draws are shifted by the tile origin
+    Surface tile_surface(x2 - x1, y2 - y1, scratch, tile_size);
+    const std::vector<uint32_t>& bin = bins[tile];
+
+    //Surface copies are opaque, only clear the part of the tile that the first one doesn't cover
+    int covered_x1 = x1, covered_x2 = x1, covered_y1 = y1, covered_y2 = y1;
+    for (uint32_t index : bin)
+    {
+        const Batch& batch = batches[draw_batches[index]];
+        if (batch.type != DrawType::SURFACE) continue;
+
+        covered_x1 = std::max(draws[index].x, x1), covered_x2 = std::max(std::min(draws[index].x + batch.surface->get_width(), x2), covered_x1);
+        covered_y1 = std::max(draws[index].y, y1), covered_y2 = std::max(std::min(draws[index].y + batch.surface->get_height(), y2), covered_y1);
+        break;
+    }
+    tile_surface.fill_rect(0, 0, x2 - x1, covered_y1 - y1, clear_color);
+    tile_surface.fill_rect(0, covered_y2 - y1, x2 - x1, y2 - y1, clear_color);
+    tile_surface.fill_rect(0, covered_y1 - y1, covered_x1 - x1, covered_y2 - y1, clear_color);
+    tile_surface.fill_rect(covered_x2 - x1, covered_y1 - y1, x2 - x1, covered_y2 - y1, clear_color);
+
+    for (size_t i = 0; i < bin.size();)
+    {
+        //The draws of the tile that belong to the same batch are next to each other in the bin
+        const Batch& batch = batches[draw_batches[bin[i]]];
+        size_t end = i + 1;
+        while ((end < bin.size()) && (draw_batches[bin[end]] == draw_batches[bin[i]])) end++;
+
+        const SpriteDraw& draw = draws[bin[i]];
+        switch (batch.type)
+        {
+        case DrawType::SPRITE:
+            batch.sprite->draw_batch(&tile_surface, draws.data(), &bin[i], end - i, x1, y1);
+            break;
+        case DrawType::SURFACE:
+        {
+            const int copy_x1 = std::max(draw.x, x1), copy_x2 = std::min(draw.x + batch.surface->get_width(), x2);
+            const int copy_y1 = std::max(draw.y, y1), copy_y2 = std::min(draw.y + batch.surface->get_height(), y2);
+            const Pixel* src = batch.surface->get_buffer();
+            const int src_pitch = batch.surface->get_pitch();
+            for (int y = copy_y1; y < copy_y2; y++)
+            {
+                memcpy(scratch + (y - y1) * tile_size + (copy_x1 - x1), src + (y - draw.y) * src_pitch + (copy_x1 - draw.x), (copy_x2 - copy_x1) * sizeof(Pixel));
+            }
+            break;
+        }
+        case DrawType::LINE:
+        {
+            const Shape& line = shapes[batch.item];
+            tile_surface.line(line.x1, line.y1, line.x2, line.y2, line.color, x1, y1, width, height);
+            break;
+        }
+        case DrawType::BAR:
+        {
+            const Shape& bar = shapes[batch.item];
+            tile_surface.fill_rect((int)bar.x1 - x1, (int)bar.y1 - y1, (int)bar.x2 + 1 - x1, (int)bar.y2 + 1 - y1, bar.color);
+            break;
+        }
+        case DrawType::TEXT:
+        {
+            const Text& text = texts[batch.item];
+            text.font->print(&tile_surface, text.text.c_str(), text.x, text.y, x1, y1, width);
+            break;
+        }
+        }
+        i = end;
+    }
+
+    //Copy the finished tile, the target is only written
+    Pixel* buffer = target->get_buffer();
+    const int pitch = target->get_pitch();
+    for (int y = y1; y < y2; y++)
+    {
+        memcpy(buffer + y * pitch + x1, scratch + (y - y1) * tile_size, (x2 - x1) * sizeof(Pixel));
+    }
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,86 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+//Renders a frame in parallel, in screen tiles
+//Draw calls are only recorded: every call is added to the bins of the tiles it overlaps, in the order
+//the calls were made. Rendering then rasterizes every tile on its own, clipped to the tile, on the thread pool.
+//Every pixel sees the draw calls that touch it in submission order, so the result is the same as drawing serially.
+//Consecutive draws of the same sprite form a batch, a tile draws the part of a batch it overlaps with one call.
+//A tile is composed in a small scratch buffer and then copied to the target, so the target is only written,
+//never read. That allows rendering straight into memory that is slow to read, like a locked texture.
+class TileRenderer
+{
+  public:
+    TileRenderer(int width, int height, int tile_size = 64);
+
+    //Start recording a frame, the tiles are first filled with clear_color
+    void begin(Pixel clear_color);
+
+    //Copy a surface like Surface::copy_to, the surface has to stay alive until render
+    void draw_surface(Surface* surface, int x, int y);
+    //Draw a frame of a sprite like Sprite::draw
+    void draw_sprite(Sprite* sprite, unsigned int frame, int x, int y);
+    //Draw a line like Surface::line
+    void draw_line(const vec2& start, const vec2& end, Pixel color);
+    //Fill a rectangle like Surface::bar, x2 and y2 are inclusive
+    void draw_bar(int x1, int y1, int x2, int y2, Pixel color);
+    //Print text like Font::print, the font has to stay alive until render
+    void draw_text(Font* font, const char* text, int x, int y);
+
+    //Rasterize all recorded draw calls to the target, which has the size of the renderer
+    void render(Surface* target, ThreadPool& thread_pool);
+
+  private:
+    enum class DrawType
+    {
+        SURFACE,
+        SPRITE,
+        LINE,
+        BAR,
+        TEXT
+    };
+
+    //Source of a run of consecutive draws
+    struct Batch
+    {
+        DrawType type;
+        Surface* surface; //Set for surface copies
+        Sprite* sprite;   //Set for sprites
+        uint32_t item;    //Shape or text of lines, bars and texts
+    };
+
+    struct Shape
+    {
+        float x1, y1, x2, y2;
+        Pixel color;
+    };
+
+    struct Text
+    {
+        Font* font;
+        std::string text;
+        int x, y;
+    };
+
+    //Record a draw that touches the pixels in [x1, x2) x [y1, y2)
+    void add(const Batch& batch, const SpriteDraw& draw, int x1, int y1, int x2, int y2);
+    void render_tile(Surface* target, int tile, Pixel* scratch) const;
+
+    const int width, height;
+    const int tile_size;
+    const int tiles_x, tiles_y;
+    static constexpr size_t tiles_per_task = 4;
+
+    Pixel clear_color = 0;
+    std::vector<Batch> batches;
+    std::vector<SpriteDraw> draws;           //All draws of the frame, in submission order
+    std::vector<uint32_t> draw_batches;      //Batch of every draw
+    std::vector<Shape> shapes;               //Lines and bars
+    std::vector<Text> texts;
+    std::vector<std::vector<uint32_t>> bins; //Draws per tile, in submission order
+    std::vector<Pixel> scratch_tiles;        //One tile buffer per render task
+};
+
+} // namespace Tmpl8